@@ -0,0 +1,255 @@
+// Benchmark harness for the Bob interpreter.
+//
+// Runs every workload several times in a child process, reports the median
+// wall time and the peak resident set size as JSON, and compares the result
+// against a saved baseline. Exits with status 1 when a workload fails or is
+// slower than the baseline by more than the threshold.
+//
+//   bench_runner [--bob PATH] [--runs N] [--threshold PCT] [--baseline FILE]
+//                [--save-baseline FILE] [--bob-arg ARG]... workload.bob...
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+struct Measurement {
+    double wallMs;
+    long peakRssKb;
+    bool ok;
+};
+
+struct Result {
+    std::string name;
+    std::string file;
+    std::vector<double> times;
+    double medianMs = 0;
+    long peakRssKb = 0;
+    bool ok = true;
+};
+
+struct BaselineEntry {
+    double medianMs;
+    long peakRssKb;
+};
+
+static std::string workloadName(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    size_t dot = name.rfind('.');
+    return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+static Measurement runOnce(const std::string& bob, const std::vector<std::string>& bobArgs, const std::string& file) {
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(bob.c_str()));
+    for (const std::string& arg : bobArgs) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(const_cast<char*>(file.c_str()));
+    argv.push_back(nullptr);
+
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid < 0) {
+        std::perror("fork");
+        return Measurement{0, 0, false};
+    }
+    if (pid == 0) {
+        int devNull = open("/dev/null", O_WRONLY);
+        if (devNull >= 0) {
+            dup2(devNull, STDOUT_FILENO);
+            dup2(devNull, STDERR_FILENO);
+        }
+        execv(bob.c_str(), argv.data());
+        _exit(127);
+    }
+
+    int status = 0;
+    struct rusage usage;
+    std::memset(&usage, 0, sizeof(usage));
+    if (wait4(pid, &status, 0, &usage) < 0) {
+        std::perror("wait4");
+        return Measurement{0, 0, false};
+    }
+    double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    return Measurement{wallMs, usage.ru_maxrss, ok};  // ru_maxrss is in kilobytes on Linux
+}
+
+static double median(std::vector<double> values) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t mid = values.size() / 2;
+    return values.size() % 2 ? values[mid] : (values[mid - 1] + values[mid]) / 2;
+}
+
+// Reads the "benchmarks" entries of a file written by this harness. The
+// format is our own, so a scan for the three fields we need is enough.
+static std::map<std::string, BaselineEntry> loadBaseline(const std::string& path) {
+    std::map<std::string, BaselineEntry> baseline;
+    std::ifstream in(path);
+    if (!in.is_open()) return baseline;
+
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    std::string text = buffer.str();
+
+    auto numberAfter = [&text](const std::string& key, size_t from, size_t to) -> double {
+        size_t at = text.find("\"" + key + "\"", from);
+        if (at == std::string::npos || at > to) return -1;
+        at = text.find(':', at);
+        return std::strtod(text.c_str() + at + 1, nullptr);
+    };
+
+    size_t pos = 0;
+    while ((pos = text.find("\"name\"", pos)) != std::string::npos) {
+        size_t open = text.find('"', text.find(':', pos) + 1);
+        size_t close = text.find('"', open + 1);
+        std::string name = text.substr(open + 1, close - open - 1);
+        size_t end = text.find('}', close);
+        double medianMs = numberAfter("median_ms", close, end);
+        double rss = numberAfter("peak_rss_kb", close, end);
+        if (medianMs >= 0) {
+            baseline[name] = BaselineEntry{medianMs, static_cast<long>(rss)};
+        }
+        pos = close;
+    }
+    return baseline;
+}
+
+static std::string jsonEscape(const std::string& text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+static void writeJson(std::ostream& out, const std::string& bob, int runs, const std::vector<Result>& results,
+                      const std::map<std::string, BaselineEntry>& baseline, double threshold) {
+    out << std::fixed << std::setprecision(2);
+    out << "{\n";
+    out << "  \"bob\": \"" << jsonEscape(bob) << "\",\n";
+    out << "  \"runs\": " << runs << ",\n";
+    out << "  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& result = results[i];
+        out << "    {\"name\": \"" << jsonEscape(result.name) << "\""
+            << ", \"file\": \"" << jsonEscape(result.file) << "\""
+            << ", \"median_ms\": " << result.medianMs
+            << ", \"min_ms\": " << (result.times.empty() ? 0 : *std::min_element(result.times.begin(), result.times.end()))
+            << ", \"max_ms\": " << (result.times.empty() ? 0 : *std::max_element(result.times.begin(), result.times.end()))
+            << ", \"peak_rss_kb\": " << result.peakRssKb;
+
+        auto base = baseline.find(result.name);
+        std::string status = result.ok ? "ok" : "failed";
+        if (base != baseline.end() && base->second.medianMs > 0) {
+            double change = 100.0 * (result.medianMs - base->second.medianMs) / base->second.medianMs;
+            out << ", \"baseline_median_ms\": " << base->second.medianMs
+                << ", \"baseline_peak_rss_kb\": " << base->second.peakRssKb
+                << ", \"change_pct\": " << change;
+            if (result.ok && change > threshold) status = "regression";
+            else if (result.ok && change < -threshold) status = "improved";
+        }
+        out << ", \"status\": \"" << status << "\"}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+int main(int argc, char* argv[]) {
+    std::string bob = "./build/bob";
+    int runs = 5;
+    double threshold = 10.0;
+    std::string baselinePath;
+    std::string savePath;
+    std::vector<std::string> bobArgs;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << arg << std::endl;
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+        if (arg == "--bob") bob = value();
+        else if (arg == "--runs") runs = std::max(1, std::atoi(value().c_str()));
+        else if (arg == "--threshold") threshold = std::atof(value().c_str());
+        else if (arg == "--baseline") baselinePath = value();
+        else if (arg == "--save-baseline") savePath = value();
+        else if (arg == "--bob-arg") bobArgs.push_back(value());
+        else files.push_back(arg);
+    }
+
+    if (files.empty()) {
+        std::cerr << "usage: bench_runner [--bob PATH] [--runs N] [--threshold PCT] [--baseline FILE]\n"
+                     "                    [--save-baseline FILE] [--bob-arg ARG]... workload.bob..." << std::endl;
+        return 2;
+    }
+
+    std::vector<Result> results;
+    for (const std::string& file : files) {
+        Result result;
+        result.name = workloadName(file);
+        result.file = file;
+        for (int run = 0; run < runs; run++) {
+            Measurement measurement = runOnce(bob, bobArgs, file);
+            if (!measurement.ok) {
+                result.ok = false;
+                break;
+            }
+            result.times.push_back(measurement.wallMs);
+            result.peakRssKb = std::max(result.peakRssKb, measurement.peakRssKb);
+        }
+        result.medianMs = median(result.times);
+        std::cerr << std::fixed << std::setprecision(2) << result.name << ": "
+                  << (result.ok ? "" : "FAILED ") << result.medianMs << " ms, "
+                  << result.peakRssKb << " KB" << std::endl;
+        results.push_back(result);
+    }
+
+    std::map<std::string, BaselineEntry> baseline;
+    if (!baselinePath.empty()) {
+        baseline = loadBaseline(baselinePath);
+        if (baseline.empty()) {
+            std::cerr << "No baseline at " << baselinePath << "; run make bench-baseline to save one" << std::endl;
+        }
+    }
+
+    writeJson(std::cout, bob, runs, results, baseline, threshold);
+
+    if (!savePath.empty()) {
+        std::ofstream out(savePath);
+        writeJson(out, bob, runs, results, {}, threshold);
+        std::cerr << "Baseline saved to " << savePath << std::endl;
+    }
+
+    bool failed = false;
+    for (const Result& result : results) {
+        auto base = baseline.find(result.name);
+        bool regressed = base != baseline.end() && base->second.medianMs > 0 &&
+                         100.0 * (result.medianMs - base->second.medianMs) / base->second.medianMs > threshold;
+        if (!result.ok || regressed) {
+            std::cerr << result.name << (result.ok ? " regressed" : " failed") << std::endl;
+            failed = true;
+        }
+    }
+    return failed ? 1 : 0;
+}
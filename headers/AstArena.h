@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator that owns the AST nodes of a program. The Parser allocates
+// every node here and links them with plain pointers; nodes are never freed
+// individually and are destroyed together when the arena goes away.
+class AstArena {
+public:
+    AstArena() = default;
+    AstArena(const AstArena&) = delete;
+    AstArena& operator=(const AstArena&) = delete;
+    ~AstArena();
+
+    template<typename T, typename... Args>
+    T* make(Args&&... args) {
+        void* memory = allocate(sizeof(T), alignof(T));
+        T* node = new (memory) T(std::forward<Args>(args)...);
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            destructors.push_back(Destructor{node, [](void* object) { static_cast<T*>(object)->~T(); }});
+        }
+        return node;
+    }
+
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    struct Destructor {
+        void* object;
+        void (*destroy)(void*);
+    };
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* cursor = nullptr;
+    size_t remaining = 0;
+    std::vector<Destructor> destructors;
+
+    void* allocate(size_t size, size_t alignment);
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "Lexer.h"
+#include "Value.h"
+
+class ErrorReporter;
+
+// Generic evaluation of binary operators for both backends. Every
+// (left type, right type, operator) triple has its own handler in one table
+// built at compile time, so an evaluation is a type lookup on each operand
+// and a single indexed call. Compound assignments index the table with their
+// own token (`+=` selects the `+` handlers). Quickened sites still try their
+// specialized form first; this is the path they fall back to.
+enum class ValueKind : uint8_t {
+    None,
+    Boolean,
+    Integer,
+    Double,
+    String,
+    Function,
+    Builtin,
+    Count
+};
+
+enum class BinaryOp : uint8_t {
+    Add,
+    Subtract,
+    Multiply,
+    Divide,
+    Modulo,
+    Greater,
+    GreaterEqual,
+    Less,
+    LessEqual,
+    Equal,
+    NotEqual,
+    BitAnd,
+    BitOr,
+    BitXor,
+    ShiftLeft,
+    ShiftRight,
+    Unsupported,  // any other token; every pair reports a type error
+    Count
+};
+
+inline ValueKind kindOf(const Value& value) {
+    if (value.isDouble()) return ValueKind::Double;
+    switch (value.bits >> 48) {
+        case Value::TAG_SPECIAL >> 48: return value.isNone() ? ValueKind::None : ValueKind::Boolean;
+        case Value::TAG_STRING >> 48: return ValueKind::String;
+        case Value::TAG_FUNCTION >> 48: return ValueKind::Function;
+        case Value::TAG_BUILTIN >> 48: return ValueKind::Builtin;
+        default: return ValueKind::Integer;
+    }
+}
+
+constexpr size_t TOKEN_TYPE_COUNT = END_OF_FILE + 1;
+
+constexpr BinaryOp binaryOpFor(TokenType type) {
+    switch (type) {
+        case PLUS: case PLUS_EQUAL: return BinaryOp::Add;
+        case MINUS: case MINUS_EQUAL: return BinaryOp::Subtract;
+        case STAR: case STAR_EQUAL: return BinaryOp::Multiply;
+        case SLASH: case SLASH_EQUAL: return BinaryOp::Divide;
+        case PERCENT: case PERCENT_EQUAL: return BinaryOp::Modulo;
+        case GREATER: return BinaryOp::Greater;
+        case GREATER_EQUAL: return BinaryOp::GreaterEqual;
+        case LESS: return BinaryOp::Less;
+        case LESS_EQUAL: return BinaryOp::LessEqual;
+        case DOUBLE_EQUAL: return BinaryOp::Equal;
+        case BANG_EQUAL: return BinaryOp::NotEqual;
+        case BIN_AND: case BIN_AND_EQUAL: return BinaryOp::BitAnd;
+        case BIN_OR: case BIN_OR_EQUAL: return BinaryOp::BitOr;
+        case BIN_XOR: case BIN_XOR_EQUAL: return BinaryOp::BitXor;
+        case BIN_SLEFT: case BIN_SLEFT_EQUAL: return BinaryOp::ShiftLeft;
+        case BIN_SRIGHT: case BIN_SRIGHT_EQUAL: return BinaryOp::ShiftRight;
+        default: return BinaryOp::Unsupported;
+    }
+}
+
+constexpr std::array<BinaryOp, TOKEN_TYPE_COUNT> makeBinaryOps() {
+    std::array<BinaryOp, TOKEN_TYPE_COUNT> ops{};
+    for (size_t type = 0; type < TOKEN_TYPE_COUNT; type++) {
+        ops[type] = binaryOpFor(static_cast<TokenType>(type));
+    }
+    return ops;
+}
+
+inline constexpr std::array<BinaryOp, TOKEN_TYPE_COUNT> BINARY_OPS = makeBinaryOps();
+
+constexpr size_t KIND_COUNT = static_cast<size_t>(ValueKind::Count);
+constexpr size_t BINARY_OP_COUNT = static_cast<size_t>(BinaryOp::Count);
+
+using BinaryHandler = Value (*)(const Token& oper, const Value& left, const Value& right, ErrorReporter* errors);
+
+// Indexed by binaryHandlerIndex; defined in BinaryDispatch.cpp
+extern const std::array<BinaryHandler, KIND_COUNT * KIND_COUNT * BINARY_OP_COUNT> BINARY_HANDLERS;
+
+constexpr size_t binaryHandlerIndex(ValueKind left, ValueKind right, BinaryOp op) {
+    return (static_cast<size_t>(left) * KIND_COUNT + static_cast<size_t>(right)) * BINARY_OP_COUNT
+        + static_cast<size_t>(op);
+}
+
+// Reports through errors and throws when the operands do not support oper
+inline Value dispatchBinary(const Token& oper, const Value& left, const Value& right, ErrorReporter* errors) {
+    size_t index = binaryHandlerIndex(kindOf(left), kindOf(right), BINARY_OPS[oper.type]);
+    return BINARY_HANDLERS[index](oper, left, right, errors);
+}
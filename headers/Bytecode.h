@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Lexer.h"
+#include "Value.h"
+#include "Quickening.h"
+#include "GlobalCache.h"
+
+// Instruction set for the bytecode VM. Operands follow the opcode inline:
+//   u8  - one byte
+//   u16 - two bytes, little endian (scope depths, slots, upvalues and slot counts)
+//   u32 - four bytes, little endian (constant, name, token and function indices; jump targets)
+enum OpCode : uint8_t {
+    OP_CONSTANT,        // u32 constant
+    OP_NONE,
+    OP_TRUE,
+    OP_FALSE,
+    OP_POP,
+    OP_ECHO,            // pop and print like an interactive expression statement
+
+    OP_DEFINE_GLOBAL,   // u32 name
+    OP_GET_GLOBAL,      // u32 name, u32 global cache
+    OP_SET_GLOBAL,      // u32 name, u32 global cache
+    OP_DEFINE_LOCAL,    // u16 slot
+    OP_GET_LOCAL,       // u16 depth, u16 slot
+    OP_SET_LOCAL,       // u16 depth, u16 slot
+    OP_DEFINE_STACK,    // u16 slot in a frame kept on the value stack
+    OP_GET_STACK,       // u16 slot in a frame kept on the value stack
+    OP_SET_STACK,       // u16 slot in a frame kept on the value stack
+    OP_GET_UPVALUE,     // u16 upvalue of the running function
+    OP_SET_UPVALUE,     // u16 upvalue of the running function
+    // u16 upvalue, u32 name, u32 global cache: an upvalue for a variable declared
+    // after the closure was created, which means the global until then
+    OP_GET_UPVALUE_OR_GLOBAL,
+    OP_SET_UPVALUE_OR_GLOBAL,
+    OP_COMPOUND_ASSIGN, // u32 name, u32 token (operator), u16 depth, u16 slot, u32 global cache
+    OP_INCREMENT,       // u32 name, u32 token (operator), u8 isPrefix, u16 depth, u16 slot, u32 global cache
+
+    OP_BINARY,          // u32 token (operator)
+    OP_NEGATE,          // u32 token (operator)
+    OP_NOT,
+    OP_BIN_NOT,         // u32 token (operator)
+
+    // Quickened operators. The VM rewrites OP_BINARY/OP_NEGATE in place into
+    // one of these after the first execution (see Quickening.h); they keep the
+    // u32 token operand so a failed speculation can fall back to the generic form.
+    // The binary forms mirror QuickOp from Generic to NotEqualStrings.
+    OP_BINARY_GENERIC,
+    OP_ADD_NUMBERS,
+    OP_SUBTRACT_NUMBERS,
+    OP_MULTIPLY_NUMBERS,
+    OP_DIVIDE_NUMBERS,
+    OP_MODULO_NUMBERS,
+    OP_LESS_NUMBERS,
+    OP_LESS_EQUAL_NUMBERS,
+    OP_GREATER_NUMBERS,
+    OP_GREATER_EQUAL_NUMBERS,
+    OP_EQUAL_NUMBERS,
+    OP_NOT_EQUAL_NUMBERS,
+    OP_ADD_INTEGERS,
+    OP_SUBTRACT_INTEGERS,
+    OP_MULTIPLY_INTEGERS,
+    OP_DIVIDE_INTEGERS,
+    OP_MODULO_INTEGERS,
+    OP_LESS_INTEGERS,
+    OP_LESS_EQUAL_INTEGERS,
+    OP_GREATER_INTEGERS,
+    OP_GREATER_EQUAL_INTEGERS,
+    OP_EQUAL_INTEGERS,
+    OP_NOT_EQUAL_INTEGERS,
+    OP_BIT_AND_INTEGERS,
+    OP_BIT_OR_INTEGERS,
+    OP_BIT_XOR_INTEGERS,
+    OP_SHIFT_LEFT_INTEGERS,
+    OP_SHIFT_RIGHT_INTEGERS,
+    OP_CONCAT_STRINGS,
+    OP_EQUAL_STRINGS,
+    OP_NOT_EQUAL_STRINGS,
+    OP_NEGATE_GENERIC,
+    OP_NEGATE_NUMBER,
+
+    OP_JUMP,            // u32 target
+    OP_JUMP_IF_FALSE,   // u32 target (pops the condition)
+    OP_JUMP_IF_TRUE,    // u32 target (pops the condition)
+    OP_JUMP_IF_FALSE_OR_POP,  // u32 target; keeps a falsy operand as the result of `and`
+    OP_JUMP_IF_TRUE_OR_POP,   // u32 target; keeps a truthy operand as the result of `or`
+
+    OP_PUSH_SCOPE,      // u16 slot count
+    OP_POP_SCOPE,
+
+    OP_CLOSURE,         // u32 function
+    OP_CALL,            // u8 argc, u32 token (closing paren)
+    OP_TAIL_CALL,       // u8 argc, u32 token (closing paren); replaces the current frame
+    OP_RETURN
+};
+
+static_assert(OP_NOT_EQUAL_STRINGS - OP_BINARY_GENERIC ==
+              static_cast<int>(QuickOp::NotEqualStrings) - static_cast<int>(QuickOp::Generic),
+              "quickened binary opcodes must mirror QuickOp");
+
+inline OpCode quickenedBinaryOpcode(QuickOp op) {
+    return static_cast<OpCode>(OP_BINARY_GENERIC + (static_cast<int>(op) - static_cast<int>(QuickOp::Generic)));
+}
+
+inline QuickOp quickOpOf(OpCode opcode) {
+    return static_cast<QuickOp>(static_cast<int>(QuickOp::Generic) + (opcode - OP_BINARY_GENERIC));
+}
+
+// Depth operand marking a variable that is resolved by name in the globals
+constexpr uint16_t GLOBAL_DEPTH = 0xFFFF;
+// Depth operand marking an upvalue; the slot operand is its index
+constexpr uint16_t UPVALUE_DEPTH = 0xFFFE;
+// Depth operand marking a slot of a frame kept on the value stack
+constexpr uint16_t STACK_DEPTH = 0xFFFD;
+
+struct FunctionPrototype;
+
+// A compiled unit of bytecode: the top-level script or one function body.
+struct Chunk {
+    std::vector<uint8_t> code;  // mutable at run time: operator sites are quickened in place
+    std::vector<Value> constants;
+    // Tokens referenced by instructions, kept for variable names and error positions
+    std::vector<Token> tokens;
+    // Prototypes of the functions declared directly in this chunk; they live
+    // in the AST, which outlives every chunk compiled from it
+    std::vector<FunctionPrototype*> functions;
+    // One cache per OP_GET_GLOBAL/OP_SET_GLOBAL/OP_COMPOUND_ASSIGN/OP_INCREMENT site (see GlobalCache.h)
+    std::vector<GlobalCache> globalCaches;
+
+    inline void write(uint8_t byte) { code.push_back(byte); }
+
+    inline void writeShort(uint16_t value) {
+        code.push_back(static_cast<uint8_t>(value & 0xff));
+        code.push_back(static_cast<uint8_t>(value >> 8));
+    }
+
+    inline void writeInt(uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            code.push_back(static_cast<uint8_t>((value >> (8 * i)) & 0xff));
+        }
+    }
+
+    inline void patchInt(size_t offset, uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            code[offset + i] = static_cast<uint8_t>((value >> (8 * i)) & 0xff);
+        }
+    }
+};
+
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "Bytecode.h"
+#include "Expression.h"
+#include "Statement.h"
+
+class ErrorReporter;
+
+// Compiles the Stmt/Expr AST into bytecode for the VM. Each function body
+// becomes its own Chunk, stored in the enclosing chunk's function table.
+class Compiler final : public ExprVisitor, public StmtVisitor {
+public:
+    explicit Compiler(bool IsInteractive) : IsInteractive(IsInteractive) {}
+
+    std::shared_ptr<Chunk> compile(const std::vector<Stmt*>& statements);
+
+    Value visitAssignExpr(AssignExpr& expression) override;
+    Value visitBinaryExpr(BinaryExpr& expression) override;
+    Value visitCallExpr(CallExpr& expression) override;
+    Value visitFunctionExpr(FunctionExpr& expression) override;
+    Value visitGroupingExpr(GroupingExpr& expression) override;
+    Value visitIncrementExpr(IncrementExpr& expression) override;
+    Value visitLiteralExpr(LiteralExpr& expression) override;
+    Value visitLogicalExpr(LogicalExpr& expression) override;
+    Value visitUnaryExpr(UnaryExpr& expression) override;
+    Value visitVarExpr(VarExpr& expression) override;
+
+    void visitBlockStmt(BlockStmt& statement, ExecutionContext* context = nullptr) override;
+    void visitExpressionStmt(ExpressionStmt& statement, ExecutionContext* context = nullptr) override;
+    void visitVarStmt(VarStmt& statement, ExecutionContext* context = nullptr) override;
+    void visitFunctionStmt(FunctionStmt& statement, ExecutionContext* context = nullptr) override;
+    void visitReturnStmt(ReturnStmt& statement, ExecutionContext* context = nullptr) override;
+    void visitIfStmt(IfStmt& statement, ExecutionContext* context = nullptr) override;
+
+private:
+    bool IsInteractive;
+    std::shared_ptr<Chunk> chunk;
+    const FunctionPrototype* function = nullptr;  // being compiled; nullptr for the script
+
+    // Whether locals of the code being compiled live on the VM's value stack
+    bool frameOnStack() const { return function != nullptr && !function->frameCaptured; }
+    bool declaredLater(int upvalue) const;
+
+    void compileStatement(Stmt* statement);
+    void compileExpression(Expr* expression);
+    void compileBranch(Expr* condition, bool jumpWhen, std::vector<size_t>& jumps);
+    uint32_t compileFunction(FunctionPrototype& prototype);
+    void emitVariable(int depth, int slot, int upvalue);
+    void emitLocal(int depth, int slot);
+    void emitDefine(const Token& name, int slot);
+    void emitCall(CallExpr& expression, OpCode op);
+
+    void emit(uint8_t byte) { chunk->write(byte); }
+    void emitShort(uint16_t value) { chunk->writeShort(value); }
+    void emitInt(uint32_t value) { chunk->writeInt(value); }
+    size_t emitJump(OpCode op);
+    void patchJump(size_t operandOffset);
+
+    uint32_t addConstant(const Value& value);
+    uint32_t addToken(const Token& token);
+    uint32_t addGlobalCache();
+};
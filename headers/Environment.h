@@ -2,27 +2,74 @@
 
 #include <unordered_map>
 #include <string>
-#include <memory>
+#include <vector>
 #include "Value.h"
 #include "Lexer.h"
+#include "GarbageCollector.h"
+#include "GlobalCache.h"
+#include "Ref.h"
 
 // Forward declaration
 class ErrorReporter;
 
+class Environment;
+using EnvironmentRef = Ref<Environment>;
+
+// Environments freed with an empty pool slot are kept for reuse
+constexpr size_t ENVIRONMENT_POOL_LIMIT = 256;
+
+// A runtime scope. Locals resolved by the Resolver live in a dense slot array
+// addressed by (depth, slot); the name map is only used by the global scope,
+// which stays dynamic so the REPL can define new globals line by line.
+// Every environment registers with the collector of its root scope, which
+// treats all of them as roots. Closures never hold a scope, only upvalues
+// for the variables they use, so a scope lives exactly as long as the code
+// running in it. Scopes are reference counted through EnvironmentRef and
+// come from a free list: a call frame or block scope goes back to the pool
+// when it is left, closing its open upvalues, and is reused, slot storage
+// included, by the next one.
 class Environment {
 public:
-    Environment() : parent(nullptr), errorReporter(nullptr) {}
-    Environment(std::shared_ptr<Environment> parent_env) : parent(parent_env), errorReporter(nullptr) {}
-    
+    // A root scope (the globals) registered with collector
+    static EnvironmentRef create(GarbageCollector* collector) {
+        return EnvironmentRef(new Environment(collector));
+    }
+
+    // A child scope with slotCount slots, undeclared until their declarations run
+    static EnvironmentRef create(const EnvironmentRef& parent, size_t slotCount = 0) {
+        if (pool.free.empty()) {
+            return EnvironmentRef(new Environment(parent, slotCount));
+        }
+        Environment* env = pool.free.back();
+        pool.free.pop_back();
+        env->reuse(parent, slotCount);
+        return EnvironmentRef(env);
+    }
+
+    // Called by EnvironmentRef when the last reference goes away
+    static void destroy(Environment* env);
+
+    Environment(const Environment&) = delete;
+    Environment& operator=(const Environment&) = delete;
+    ~Environment() {
+        if (collector) {
+            untrack();
+        }
+    }
+
     // Set error reporter for enhanced error reporting
     void setErrorReporter(ErrorReporter* reporter) {
         errorReporter = reporter;
     }
     
-    // Optimized define with inline
-    inline void define(const std::string& name, const Value& value) {
+    inline void define(Symbol name, const Value& value) {
         variables[name] = value;
     }
+
+    // For names that do not come from a token, e.g. builtins
+    inline void define(const std::string& name, const Value& value) {
+        define(SymbolTable::intern(name), value);
+    }
     
     // Enhanced assign with error reporting
     void assign(const Token& name, const Value& value);
@@ -32,17 +79,114 @@ public:
     
     // Get by string name with error reporting
     Value get(const std::string& name);
+
+    // Storage of a defined name, remembered in the caller's cache so repeated
+    // lookups from the same site skip hashing the name
+    inline Value& lookup(GlobalCache& cache, const Token& name) {
+        if (cache.epoch == epoch) {
+            return *cache.binding;
+        }
+        return bind(cache, name);
+    }
+
+    // Slot access for resolved locals: walk depth parents, then index
+    inline Value& at(int depth, int slot) {
+        return ancestor(depth)->slots[slot];
+    }
+
+    inline Environment* ancestor(int depth) {
+        Environment* env = this;
+        for (int i = 0; i < depth; i++) {
+            env = env->parent.get();
+        }
+        return env;
+    }
+
+    inline Value& slot(int index) { return slots[index]; }
+
+    // The open upvalue for a slot, shared by every closure that captures it
+    UpvalueRef capture(int slot);
     
-    std::shared_ptr<Environment> getParent() const { return parent; }
-    inline void clear() { variables.clear(); }
+    const EnvironmentRef& getParent() const { return parent; }
+    inline void clear() {
+        variables.clear();
+        epoch = ++nextEpoch;  // invalidates every cached binding into this scope
+    }
     
     // Set parent environment for TCO environment reuse
-    inline void setParent(std::shared_ptr<Environment> newParent) {
+    inline void setParent(const EnvironmentRef& newParent) {
         parent = newParent;
     }
 
+    // Clear and resize the slots so a tail call can reuse this frame
+    inline void resetSlots(size_t slotCount) {
+        if (openUpvalues) {
+            closeUpvalues();
+        }
+        slots.clear();
+        slots.resize(slotCount, Value::undeclared());
+    }
+
 private:
-    std::unordered_map<std::string, Value> variables;
-    std::shared_ptr<Environment> parent;
+    friend class GarbageCollector;
+    friend class Ref<Environment>;
+    friend struct Upvalue;
+
+    uint32_t refCount = 0;
+    std::vector<Value> slots;
+    Upvalue* openUpvalues = nullptr;  // captured slots, closed when the scope ends
+    std::unordered_map<Symbol, Value> variables;
+    EnvironmentRef parent;
     ErrorReporter* errorReporter;
-};
\ No newline at end of file
+
+    // Identifies this scope's bindings to GlobalCache; unique across scopes
+    uint64_t epoch;
+    static inline uint64_t nextEpoch = 0;
+
+    Value& bind(GlobalCache& cache, const Token& name);
+    void closeUpvalues();
+
+    struct Pool {
+        std::vector<Environment*> free;
+        ~Pool();
+    };
+    static inline Pool pool;
+
+    explicit Environment(GarbageCollector* collector)
+        : parent(nullptr), errorReporter(nullptr), epoch(++nextEpoch), collector(collector) {
+        track();
+    }
+    Environment(const EnvironmentRef& parent_env, size_t slotCount)
+        : slots(slotCount, Value::undeclared()), parent(parent_env), errorReporter(nullptr), epoch(++nextEpoch),
+          collector(parent_env ? parent_env->collector : nullptr) {
+        track();
+    }
+
+    // Turns a pooled environment back into a fresh child scope
+    inline void reuse(const EnvironmentRef& parent_env, size_t slotCount) {
+        slots.resize(slotCount, Value::undeclared());
+        parent = parent_env;
+        epoch = ++nextEpoch;
+        collector = parent_env ? parent_env->collector : nullptr;
+        track();
+    }
+
+    // Collector bookkeeping
+    GarbageCollector* collector;
+    Environment* gcPrev = nullptr;
+    Environment* gcNext = nullptr;
+
+    inline void track() {
+        if (!collector) return;
+        gcPrev = nullptr;
+        gcNext = collector->environments;
+        if (gcNext) gcNext->gcPrev = this;
+        collector->environments = this;
+    }
+
+    inline void untrack() {
+        if (gcPrev) gcPrev->gcNext = gcNext;
+        else collector->environments = gcNext;
+        if (gcNext) gcNext->gcPrev = gcPrev;
+    }
+};
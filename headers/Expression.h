@@ -1,154 +1,252 @@
-//
-// Created by Bobby Lucero on 5/21/23.
-//
+// Generated by tools/GenerateAST. Edit the node list in tools/GenerateAST.cpp
+// and run `make ast` instead of changing this file by hand.
 
 #pragma once
+#include <cstdint>
 #include <iostream>
 #include <memory>
+#include <utility>
+#include <vector>
 #include "Lexer.h"
 #include "helperFunctions/ShortHands.h"
 #include "TypeWrapper.h"
 #include "Value.h"
+#include "Quickening.h"
+#include "GlobalCache.h"
 
-// Forward declarations
-struct FunctionExpr;
-struct IncrementExpr;
-struct ExprVisitor;
+// The node when it has type T, nullptr otherwise (including for nullptr)
+template<typename T, typename Node>
+inline T* nodeCast(Node* node) {
+    return node != nullptr && node->kind == T::KIND ? static_cast<T*>(node) : nullptr;
+}
 
 struct AssignExpr;
 struct BinaryExpr;
+struct CallExpr;
+struct FunctionExpr;
 struct GroupingExpr;
+struct IncrementExpr;
 struct LiteralExpr;
+struct LogicalExpr;
 struct UnaryExpr;
 struct VarExpr;
-struct CallExpr;
 
-// AST nodes use shared_ptr for proper memory management
+enum class ExprKind : uint8_t {
+    Assign,
+    Binary,
+    Call,
+    Function,
+    Grouping,
+    Increment,
+    Literal,
+    Logical,
+    Unary,
+    Var
+};
+
+// Every visitor implements one method per node type
 struct ExprVisitor
 {
-    virtual Value visitAssignExpr(const std::shared_ptr<AssignExpr>& expr) = 0;
-    virtual Value visitBinaryExpr(const std::shared_ptr<BinaryExpr>& expr) = 0;
-    virtual Value visitCallExpr(const std::shared_ptr<CallExpr>& expr) = 0;
-    virtual Value visitFunctionExpr(const std::shared_ptr<FunctionExpr>& expr) = 0;
-    virtual Value visitGroupingExpr(const std::shared_ptr<GroupingExpr>& expr) = 0;
-    virtual Value visitIncrementExpr(const std::shared_ptr<IncrementExpr>& expr) = 0;
-    virtual Value visitLiteralExpr(const std::shared_ptr<LiteralExpr>& expr) = 0;
-    virtual Value visitUnaryExpr(const std::shared_ptr<UnaryExpr>& expr) = 0;
-    virtual Value visitVarExpr(const std::shared_ptr<VarExpr>& expr) = 0;
+    virtual Value visitAssignExpr(AssignExpr& expr) = 0;
+    virtual Value visitBinaryExpr(BinaryExpr& expr) = 0;
+    virtual Value visitCallExpr(CallExpr& expr) = 0;
+    virtual Value visitFunctionExpr(FunctionExpr& expr) = 0;
+    virtual Value visitGroupingExpr(GroupingExpr& expr) = 0;
+    virtual Value visitIncrementExpr(IncrementExpr& expr) = 0;
+    virtual Value visitLiteralExpr(LiteralExpr& expr) = 0;
+    virtual Value visitLogicalExpr(LogicalExpr& expr) = 0;
+    virtual Value visitUnaryExpr(UnaryExpr& expr) = 0;
+    virtual Value visitVarExpr(VarExpr& expr) = 0;
 };
 
-struct Expr : public std::enable_shared_from_this<Expr> {
-    virtual Value accept(ExprVisitor* visitor) = 0;
-    virtual ~Expr() = default;
+// AST nodes are owned by an AstArena and link to each other with plain
+// pointers. The base only holds the node's kind: nodes have no vtable.
+struct Expr
+{
+    const ExprKind kind;
+
+protected:
+    explicit Expr(ExprKind kind) : kind(kind) {}
 };
 
 struct AssignExpr : Expr
 {
+    static constexpr ExprKind KIND = ExprKind::Assign;
+
     const Token name;
     const Token op;
-    std::shared_ptr<Expr> value;
-    AssignExpr(Token name, Token op, std::shared_ptr<Expr> value)
-        : name(name), op(op), value(value) {}
-    Value accept(ExprVisitor* visitor) override
-    {
-        return visitor->visitAssignExpr(std::static_pointer_cast<AssignExpr>(shared_from_this()));
-    }
+    Expr* value;
+    // Set by the Resolver: a local at (depth, slot) or an upvalue of the
+    // running function; a global looked up by name when both are -1
+    int depth = -1;
+    int slot = -1;
+    int upvalue = -1;
+    GlobalCache global;  // binding of a global target, filled on first assignment
+
+    AssignExpr(Token name, Token op, Expr* value)
+        : Expr(KIND), name(name), op(op), value(value) {}
 };
 
 struct BinaryExpr : Expr
 {
-    std::shared_ptr<Expr> left;
+    static constexpr ExprKind KIND = ExprKind::Binary;
+
+    Expr* left;
     const Token oper;
-    std::shared_ptr<Expr> right;
+    Expr* right;
+    QuickOp quick = QuickOp::Unspecialized;  // operand-type specialization, rewritten at run time
 
-    BinaryExpr(std::shared_ptr<Expr> left, Token oper, std::shared_ptr<Expr> right)
-        : left(left), oper(oper), right(right) {}
-    Value accept(ExprVisitor* visitor) override{
-        return visitor->visitBinaryExpr(std::static_pointer_cast<BinaryExpr>(shared_from_this()));
-    }
+    BinaryExpr(Expr* left, Token oper, Expr* right)
+        : Expr(KIND), left(left), oper(oper), right(right) {}
 };
 
-struct GroupingExpr : Expr
+struct CallExpr : Expr
 {
-    std::shared_ptr<Expr> expression;
+    static constexpr ExprKind KIND = ExprKind::Call;
 
-    explicit GroupingExpr(std::shared_ptr<Expr> expression) : expression(expression) {}
-    Value accept(ExprVisitor* visitor) override{
-        return visitor->visitGroupingExpr(std::static_pointer_cast<GroupingExpr>(shared_from_this()));
-    }
+    Expr* callee;
+    Token paren;
+    std::vector<Expr*> arguments;
+    bool isTailCall = false;  // Flag for tail call optimization
+
+    CallExpr(Expr* callee, Token paren, std::vector<Expr*> arguments)
+        : Expr(KIND), callee(callee), paren(paren), arguments(std::move(arguments)) {}
 };
 
-struct LiteralExpr : Expr
+struct FunctionExpr : Expr
 {
-    std::string value;
-    bool isNumber;
-    bool isNull;
-    bool isBoolean;
-
-    LiteralExpr(const std::string& value, bool isNumber, bool isNull, bool isBoolean)
-        : value(value), isNumber(isNumber), isNull(isNull), isBoolean(isBoolean) {}
-    Value accept(ExprVisitor* visitor) override{
-        return visitor->visitLiteralExpr(std::static_pointer_cast<LiteralExpr>(shared_from_this()));
-    }
+    static constexpr ExprKind KIND = ExprKind::Function;
+
+    std::vector<Token> params;
+    std::vector<Stmt*> body;
+    FunctionPrototype prototype{"anonymous"};  // completed by the Resolver
+
+    FunctionExpr(std::vector<Token> params, std::vector<Stmt*> body)
+        : Expr(KIND), params(std::move(params)), body(std::move(body)) {}
 };
 
-struct UnaryExpr : Expr
+struct GroupingExpr : Expr
 {
-    Token oper;
-    std::shared_ptr<Expr> right;
-    UnaryExpr(Token oper, std::shared_ptr<Expr> right) : oper(oper), right(right) {}
-    Value accept(ExprVisitor* visitor) override{
-        return visitor->visitUnaryExpr(std::static_pointer_cast<UnaryExpr>(shared_from_this()));
-    }
+    static constexpr ExprKind KIND = ExprKind::Grouping;
+
+    Expr* expression;
+
+    explicit GroupingExpr(Expr* expression)
+        : Expr(KIND), expression(expression) {}
 };
 
-struct VarExpr : Expr
+struct IncrementExpr : Expr
 {
-    Token name;
-    explicit VarExpr(Token name) : name(name){};
-    Value accept(ExprVisitor* visitor) override
-    {
-        return visitor->visitVarExpr(std::static_pointer_cast<VarExpr>(shared_from_this()));
-    }
+    static constexpr ExprKind KIND = ExprKind::Increment;
+
+    Expr* operand;
+    Token oper;
+    bool isPrefix;  // true for ++x, false for x++
+    // Set by the Resolver: a local at (depth, slot) or an upvalue of the
+    // running function; a global looked up by name when both are -1
+    int depth = -1;
+    int slot = -1;
+    int upvalue = -1;
+
+    IncrementExpr(Expr* operand, Token oper, bool isPrefix)
+        : Expr(KIND), operand(operand), oper(oper), isPrefix(isPrefix) {}
 };
 
-struct FunctionExpr : Expr {
-    std::vector<Token> params;
-    std::vector<std::shared_ptr<Stmt>> body;
-    FunctionExpr(const std::vector<Token>& params, const std::vector<std::shared_ptr<Stmt>>& body)
-        : params(params), body(body) {}
-    Value accept(ExprVisitor* visitor) override
-    {
-        return visitor->visitFunctionExpr(std::static_pointer_cast<FunctionExpr>(shared_from_this()));
-    }
+struct LiteralExpr : Expr
+{
+    static constexpr ExprKind KIND = ExprKind::Literal;
+
+    const Value value;  // decoded by the Parser (or produced by constant folding)
+
+    explicit LiteralExpr(Value value)
+        : Expr(KIND), value(std::move(value)) {}
 };
 
-struct CallExpr : Expr
+// `and` / `or`: evaluates the right operand only when the left one does not
+// decide the result, and yields whichever operand decided it
+struct LogicalExpr : Expr
 {
-    std::shared_ptr<Expr> callee;
-    Token paren;
-    std::vector<std::shared_ptr<Expr>> arguments;
-    bool isTailCall = false;  // Flag for tail call optimization
-    
-    CallExpr(std::shared_ptr<Expr> callee, Token paren, std::vector<std::shared_ptr<Expr>> arguments)
-        : callee(callee), paren(paren), arguments(arguments) {}
-    Value accept(ExprVisitor* visitor) override
-    {
-        return visitor->visitCallExpr(std::static_pointer_cast<CallExpr>(shared_from_this()));
+    static constexpr ExprKind KIND = ExprKind::Logical;
+
+    Expr* left;
+    const Token oper;
+    Expr* right;
+    // Operands that are themselves logical, so a condition can branch through
+    // them without building intermediate values. Kept in sync by link().
+    LogicalExpr* leftLogical = nullptr;
+    LogicalExpr* rightLogical = nullptr;
+
+    LogicalExpr(Expr* left, Token oper, Expr* right)
+        : Expr(KIND), left(left), oper(oper), right(right) { link(); }
+
+    void link() {
+        leftLogical = from(left);
+        rightLogical = from(right);
+    }
+
+    // The logical expression inside any parentheses, or nullptr
+    static LogicalExpr* from(Expr* expression) {
+        while (auto* grouping = nodeCast<GroupingExpr>(expression)) {
+            expression = grouping->expression;
+        }
+        return nodeCast<LogicalExpr>(expression);
     }
 };
 
-struct IncrementExpr : Expr
+struct UnaryExpr : Expr
 {
-    std::shared_ptr<Expr> operand;
+    static constexpr ExprKind KIND = ExprKind::Unary;
+
     Token oper;
-    bool isPrefix;  // true for ++x, false for x++
-    
-    IncrementExpr(std::shared_ptr<Expr> operand, Token oper, bool isPrefix)
-        : operand(operand), oper(oper), isPrefix(isPrefix) {}
-    Value accept(ExprVisitor* visitor) override
-    {
-        return visitor->visitIncrementExpr(std::static_pointer_cast<IncrementExpr>(shared_from_this()));
-    }
+    Expr* right;
+    QuickOp quick = QuickOp::Unspecialized;
+
+    UnaryExpr(Token oper, Expr* right)
+        : Expr(KIND), oper(oper), right(right) {}
 };
 
+struct VarExpr : Expr
+{
+    static constexpr ExprKind KIND = ExprKind::Var;
+
+    Token name;
+    // Set by the Resolver: a local at (depth, slot) or an upvalue of the
+    // running function; a global looked up by name when both are -1
+    int depth = -1;
+    int slot = -1;
+    int upvalue = -1;
+    GlobalCache global;  // binding of a global, filled on first evaluation
+
+    explicit VarExpr(Token name)
+        : Expr(KIND), name(name) {}
+};
+
+// Calls the visit method for the node's kind. With a final visitor class
+// the call is direct, so a visit costs one switch and no virtual calls.
+template<typename Visitor>
+inline Value visitExpr(Visitor& visitor, Expr& node)
+{
+    switch (node.kind) {
+        case ExprKind::Assign:
+            return visitor.visitAssignExpr(static_cast<AssignExpr&>(node));
+        case ExprKind::Binary:
+            return visitor.visitBinaryExpr(static_cast<BinaryExpr&>(node));
+        case ExprKind::Call:
+            return visitor.visitCallExpr(static_cast<CallExpr&>(node));
+        case ExprKind::Function:
+            return visitor.visitFunctionExpr(static_cast<FunctionExpr&>(node));
+        case ExprKind::Grouping:
+            return visitor.visitGroupingExpr(static_cast<GroupingExpr&>(node));
+        case ExprKind::Increment:
+            return visitor.visitIncrementExpr(static_cast<IncrementExpr&>(node));
+        case ExprKind::Literal:
+            return visitor.visitLiteralExpr(static_cast<LiteralExpr&>(node));
+        case ExprKind::Logical:
+            return visitor.visitLogicalExpr(static_cast<LogicalExpr&>(node));
+        case ExprKind::Unary:
+            return visitor.visitUnaryExpr(static_cast<UnaryExpr&>(node));
+        case ExprKind::Var:
+            return visitor.visitVarExpr(static_cast<VarExpr&>(node));
+    }
+    __builtin_unreachable();
+}
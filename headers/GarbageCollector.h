@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <utility>
+#include <vector>
+#include "TypeWrapper.h"
+#include "Value.h"
+
+class Environment;
+
+// Collect once this many functions exist, then whenever the heap doubles
+constexpr size_t GC_INITIAL_THRESHOLD = 1024;
+
+// Tracing mark-sweep collector for Function objects. Values point at functions
+// without owning them, so a closure stored in a variable it captured is a
+// cycle that reference counting alone would never free. Environments and
+// upvalues stay reference counted. Closures hold no environments, so every
+// live environment belongs to running code and is a root; the collector
+// marks from those plus the value roots reported by the root marker, through
+// the upvalues of every closure it reaches. Unmarked functions are deleted,
+// which releases the upvalues only they used.
+class GarbageCollector {
+public:
+    struct Stats {
+        size_t collections = 0;
+        size_t functionsFreed = 0;
+        size_t heapBytes = 0;      // live heap after the last collection
+        size_t peakHeapBytes = 0;  // largest heap seen when a collection started
+        double totalPauseMs = 0;
+        double maxPauseMs = 0;
+    };
+
+    GarbageCollector() = default;
+    GarbageCollector(const GarbageCollector&) = delete;
+    GarbageCollector& operator=(const GarbageCollector&) = delete;
+    ~GarbageCollector();
+
+    // Allocate a function on the collected heap. This is the only safepoint:
+    // anything holding a function in a C++ local across it must report it
+    // through the root marker.
+    template<typename... Args>
+    Function* newFunction(Args&&... args) {
+        if (functions.size() >= nextCollection) {
+            collect();
+        }
+        Function* function = new Function(std::forward<Args>(args)...);
+        functions.push_back(function);
+        return function;
+    }
+
+    // Reports values held outside environments (evaluation temporaries, VM stack)
+    void setRootMarker(std::function<void(GarbageCollector&)> marker) { rootMarker = std::move(marker); }
+
+    void markValue(const Value& value) {
+        if (value.isFunction()) {
+            markFunction(value.asFunction());
+        }
+    }
+    void markFunction(Function* function);
+
+    void collect();
+
+    // Current size of the collected heap: functions, their upvalues and the live environments
+    size_t heapSize() const;
+    const Stats& getStats() const { return stats; }
+    void printStats(std::ostream& out) const;
+
+private:
+    friend class Environment;
+
+    std::vector<Function*> functions;
+    Environment* environments = nullptr;  // intrusive list of every live environment
+    std::vector<Function*> grayFunctions;
+    std::function<void(GarbageCollector&)> rootMarker;
+    size_t nextCollection = GC_INITIAL_THRESHOLD;
+    Stats stats;
+
+    void traceReferences();
+};
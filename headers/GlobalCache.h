@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include "Value.h"
+
+// Per-site cache of a global binding, filled on the first lookup through
+// Environment::lookup. The globals are an unordered_map whose nodes never
+// move, so the cached location stays valid and sees every reassignment or
+// redefinition of the name; it is dropped only when the scope's epoch
+// changes, i.e. for a different scope or after the scope is cleared. Locals
+// that shadow a global are bound to slots by the Resolver and never reach
+// a global site.
+struct GlobalCache {
+    uint64_t epoch = 0;  // 0 never matches a scope
+    Value* binding = nullptr;
+};
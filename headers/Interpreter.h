@@ -7,63 +7,128 @@
 #include "Value.h"
 #include "StdLib.h"
 #include "ErrorReporter.h"
+#include "VM.h"
+#include "GarbageCollector.h"
+#include "Profiler.h"
 
+#include <functional>
 #include <vector>
 #include <memory>
 #include <unordered_map>
 #include <stack>
 
-class Interpreter : public ExprVisitor, public StmtVisitor {
+class Interpreter final : public ExprVisitor, public StmtVisitor {
 
 public:
-    Value visitBinaryExpr(const std::shared_ptr<BinaryExpr>& expression) override;
-    Value visitCallExpr(const std::shared_ptr<CallExpr>& expression) override;
-    Value visitFunctionExpr(const std::shared_ptr<FunctionExpr>& expression) override;
-    Value visitGroupingExpr(const std::shared_ptr<GroupingExpr>& expression) override;
-    Value visitLiteralExpr(const std::shared_ptr<LiteralExpr>& expression) override;
-    Value visitUnaryExpr(const std::shared_ptr<UnaryExpr>& expression) override;
-    Value visitVarExpr(const std::shared_ptr<VarExpr>& expression) override;
-    Value visitIncrementExpr(const std::shared_ptr<IncrementExpr>& expression) override;
-    Value visitAssignExpr(const std::shared_ptr<AssignExpr>& expression) override;
+    Value visitBinaryExpr(BinaryExpr& expression) override;
+    Value visitCallExpr(CallExpr& expression) override;
+    Value visitFunctionExpr(FunctionExpr& expression) override;
+    Value visitGroupingExpr(GroupingExpr& expression) override;
+    Value visitLiteralExpr(LiteralExpr& expression) override;
+    Value visitLogicalExpr(LogicalExpr& expression) override;
+    Value visitUnaryExpr(UnaryExpr& expression) override;
+    Value visitVarExpr(VarExpr& expression) override;
+    Value visitIncrementExpr(IncrementExpr& expression) override;
+    Value visitAssignExpr(AssignExpr& expression) override;
 
-    void visitBlockStmt(const std::shared_ptr<BlockStmt>& statement, ExecutionContext* context = nullptr) override;
-    void visitExpressionStmt(const std::shared_ptr<ExpressionStmt>& statement, ExecutionContext* context = nullptr) override;
-    void visitVarStmt(const std::shared_ptr<VarStmt>& statement, ExecutionContext* context = nullptr) override;
-    void visitFunctionStmt(const std::shared_ptr<FunctionStmt>& statement, ExecutionContext* context = nullptr) override;
-    void visitReturnStmt(const std::shared_ptr<ReturnStmt>& statement, ExecutionContext* context = nullptr) override;
-    void visitIfStmt(const std::shared_ptr<IfStmt>& statement, ExecutionContext* context = nullptr) override;
+    void visitBlockStmt(BlockStmt& statement, ExecutionContext* context = nullptr) override;
+    void visitExpressionStmt(ExpressionStmt& statement, ExecutionContext* context = nullptr) override;
+    void visitVarStmt(VarStmt& statement, ExecutionContext* context = nullptr) override;
+    void visitFunctionStmt(FunctionStmt& statement, ExecutionContext* context = nullptr) override;
+    void visitReturnStmt(ReturnStmt& statement, ExecutionContext* context = nullptr) override;
+    void visitIfStmt(IfStmt& statement, ExecutionContext* context = nullptr) override;
 
-    void interpret(std::vector<std::shared_ptr<Stmt> > statements);
+    void interpret(const std::vector<Stmt*>& statements);
 
-    explicit Interpreter(bool IsInteractive) : IsInteractive(IsInteractive), errorReporter(nullptr){
-        environment = std::make_shared<Environment>();
+    explicit Interpreter(bool IsInteractive) : IsInteractive(IsInteractive), errorReporter(nullptr), vm(*this) {
+        globals = Environment::create(&gc);
+        environment = globals;
+        gc.setRootMarker([this](GarbageCollector& collector) {
+            for (const Value& value : tempRoots) {
+                collector.markValue(value);
+            }
+            for (const Value& value : callStack) {
+                collector.markValue(value);
+            }
+            vm.markRoots(collector);
+        });
     }
     virtual ~Interpreter() = default;
 
 private:
-    std::shared_ptr<Environment> environment;
+    GarbageCollector gc;  // declared first so it outlives every environment below
+    EnvironmentRef environment;
+    EnvironmentRef globals;  // name-based scope for top-level definitions
+    Function* currentFunction = nullptr;  // closure whose body is running; its upvalues are in scope
+    // Where the running call keeps its slots: on callStack from frameBase, or
+    // in environment when a closure captured the frame (or at the top level)
+    bool frameOnStack = false;
+    size_t frameBase = 0;
     bool IsInteractive;
     std::vector<std::shared_ptr<BuiltinFunction> > builtinFunctions;
-    std::vector<std::shared_ptr<Function> > functions;
+    std::vector<Value> tempRoots;  // functions held in C++ locals while the tree-walker evaluates
+    std::vector<Value> callStack;  // callees and arguments of the tree-walker's calls in progress
     ErrorReporter* errorReporter;
+    bool useBytecode = true;
+    Profiler* profiler = nullptr;  // set by --profile
+    std::function<void()> exitHook;
+    VM vm;
     
-    Value evaluate(const std::shared_ptr<Expr>& expr);
-    bool isEqual(Value a, Value b);
-    bool isWholeNumer(double num);
-    void execute(const std::shared_ptr<Stmt>& statement, ExecutionContext* context = nullptr);
-    void executeBlock(std::vector<std::shared_ptr<Stmt> > statements, std::shared_ptr<Environment> env, ExecutionContext* context = nullptr);
+    Value evaluate(Expr* expr);
+    inline Value& local(int depth, int slot) {
+        return frameOnStack ? callStack[frameBase + slot] : environment->at(depth, slot);
+    }
+    // An upvalue of the running function, or the global of that name while
+    // the variable it stands for is undeclared
+    inline Value& upvalue(int index, GlobalCache& cache, const Token& name) {
+        Value* value = currentFunction->binding(index);
+        return value ? *value : globals->lookup(cache, name);
+    }
+    bool isConditionTrue(LogicalExpr& expression);
+    bool isEqual(const Value& a, const Value& b);
+    void execute(Stmt* statement, ExecutionContext* context = nullptr);
+    void executeBlock(const std::vector<Stmt*>& statements, EnvironmentRef env, ExecutionContext* context = nullptr);
     void addStdLibFunctions();
+    size_t pushCall(CallExpr& expression);
+    Value call(size_t base, size_t argCount, const Token& paren);
+    Value callFunction(size_t base, size_t argCount);
     
 public:
-    bool isTruthy(Value object);
-    std::string stringify(Value object);
+    bool isTruthy(const Value& object);
+    std::string stringify(const Value& object);
     void addBuiltinFunction(std::shared_ptr<BuiltinFunction> func);
+    GarbageCollector& getCollector() { return gc; }
+
+    // Select the bytecode VM (default) or the tree-walking evaluator
+    void setUseBytecode(bool enabled) { useBytecode = enabled; }
+
+    // Report every call to profiler; nullptr disables profiling
+    void setProfiler(Profiler* newProfiler) {
+        profiler = newProfiler;
+        vm.setProfiler(newProfiler);
+    }
+
+    // Run once by the exit builtin before it ends the process, so exit-time
+    // reports are still written
+    void setExitHook(std::function<void()> hook) { exitHook = std::move(hook); }
+    void runExitHook() {
+        std::function<void()> hook = std::move(exitHook);
+        exitHook = nullptr;
+        if (hook) hook();
+    }
+
+    // Operator semantics shared by the tree-walker and the VM. Compound
+    // assignments go through binaryOperation with their own token.
+    Value binaryOperation(const Token& oper, const Value& left, const Value& right);
+    Value unaryOperation(const Token& oper, const Value& right);
+    Value incrementOperation(const Token& oper, const Value& currentValue);
 
     // Error reporting
     void setErrorReporter(ErrorReporter* reporter) { 
         errorReporter = reporter; 
-        if (environment) {
-            environment->setErrorReporter(reporter);
+        vm.setErrorReporter(reporter);
+        if (globals) {
+            globals->setErrorReporter(reporter);
         }
         
         // Add standard library functions after error reporter is set
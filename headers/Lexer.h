@@ -1,8 +1,11 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <deque>
 #include <map>
 #include <vector>
+#include "Symbol.h"
 
 enum TokenType{
     OPEN_PAREN, CLOSE_PAREN, OPEN_BRACE, CLOSE_BRACE,
@@ -57,7 +60,8 @@ inline std::string enum_mapping[] = {"OPEN_PAREN", "CLOSE_PAREN", "OPEN_BRACE",
 
                            "END_OF_FILE"};
 
-const std::map<std::string, TokenType> KEYWORDS {
+// std::less<> allows lookups by string_view without building a string
+const std::map<std::string, TokenType, std::less<>> KEYWORDS {
         {"and", AND},
         {"or", OR},
         {"true", TRUE},
@@ -75,12 +79,16 @@ const std::map<std::string, TokenType> KEYWORDS {
         {"return", RETURN},
 };
 
+// lexeme views either the source buffer or a decoded string literal, both
+// owned by the Lexer that produced the token and kept alive as long as it is.
+// Identifiers also carry the interned symbol of their name.
 struct Token
 {
     TokenType type;
-    std::string lexeme;
+    std::string_view lexeme;
     int line;
     int column;
+    Symbol symbol = NO_SYMBOL;
 };
 
 
@@ -101,15 +109,23 @@ public:
 private:
     int line;
     int column;
-    std::vector<char> src;
+    std::string_view src;
+    size_t current;
     ErrorReporter* errorReporter;
+
+    // Every buffer ever tokenized, so lexemes stay valid for ASTs that outlive
+    // a REPL line. deque keeps element addresses stable as it grows.
+    std::deque<std::string> sources;
+    std::deque<std::string> literals;
     
 private:
-    bool matchOn(char expected);
+    inline bool isAtEnd() const { return current >= src.size(); }
+    inline char peek() const { return isAtEnd() ? '\0' : src[current]; }
+    inline char peekNext() const { return current + 1 < src.size() ? src[current + 1] : '\0'; }
 
-    char peekNext();
+    bool matchOn(char expected);
 
     void advance(int by = 1);
 
-    std::string parseEscapeCharacters(const std::string &input);
+    std::string parseEscapeCharacters(std::string_view input);
 };
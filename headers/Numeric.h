@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include "Lexer.h"
+#include "Value.h"
+
+// Number semantics shared by both backends, the quickened operator sites and
+// the Optimizer. Integers stay integers while the exact result fits in
+// int64: an overflow, a division with a remainder or a double operand gives
+// a double instead. Comparing an integer with a double is exact, without
+// rounding the integer. Bitwise operators work on 64-bit integers, truncating
+// double operands; shifts take a count from 0 to 63 and shifting left wraps.
+enum class NumericResult {
+    Ok,
+    DivideByZero,
+    ModuloByZero,
+    NotAnInteger,     // a bitwise operand that is NaN or outside the int64 range
+    BadShiftCount,
+    NotNumeric        // the operator has no meaning for two numbers
+};
+
+// Truncates a bitwise operand to int64. False for NaN and out-of-range values.
+inline bool toBitwiseOperand(const Value& value, int64_t& out) {
+    if (value.isInteger()) {
+        out = value.asInteger();
+        return true;
+    }
+    double number = value.asNumber();
+    if (!(number >= -9223372036854775808.0 && number < 9223372036854775808.0)) return false;
+    out = static_cast<int64_t>(number);
+    return true;
+}
+
+inline NumericResult integerBinary(TokenType op, int64_t a, int64_t b, Value& result) {
+    int64_t out;
+    switch (op) {
+        case PLUS:
+            if (__builtin_add_overflow(a, b, &out)) {
+                result = Value(static_cast<double>(a) + static_cast<double>(b));
+            } else {
+                result = Value::integer(out);
+            }
+            return NumericResult::Ok;
+        case MINUS:
+            if (__builtin_sub_overflow(a, b, &out)) {
+                result = Value(static_cast<double>(a) - static_cast<double>(b));
+            } else {
+                result = Value::integer(out);
+            }
+            return NumericResult::Ok;
+        case STAR:
+            if (__builtin_mul_overflow(a, b, &out)) {
+                result = Value(static_cast<double>(a) * static_cast<double>(b));
+            } else {
+                result = Value::integer(out);
+            }
+            return NumericResult::Ok;
+        case SLASH:
+            if (b == 0) return NumericResult::DivideByZero;
+            if (b != -1 && a % b == 0) {
+                result = Value::integer(a / b);
+            } else if (b == -1 && a != INT64_MIN) {
+                result = Value::integer(-a);
+            } else {
+                result = Value(static_cast<double>(a) / static_cast<double>(b));
+            }
+            return NumericResult::Ok;
+        case PERCENT:
+            if (b == 0) return NumericResult::ModuloByZero;
+            result = Value::integer(b == -1 ? 0 : a % b);
+            return NumericResult::Ok;
+        case GREATER: result = Value(a > b); return NumericResult::Ok;
+        case GREATER_EQUAL: result = Value(a >= b); return NumericResult::Ok;
+        case LESS: result = Value(a < b); return NumericResult::Ok;
+        case LESS_EQUAL: result = Value(a <= b); return NumericResult::Ok;
+        case DOUBLE_EQUAL: result = Value(a == b); return NumericResult::Ok;
+        case BANG_EQUAL: result = Value(a != b); return NumericResult::Ok;
+        case BIN_AND: result = Value::integer(a & b); return NumericResult::Ok;
+        case BIN_OR: result = Value::integer(a | b); return NumericResult::Ok;
+        case BIN_XOR: result = Value::integer(a ^ b); return NumericResult::Ok;
+        case BIN_SLEFT:
+            if (b < 0 || b > 63) return NumericResult::BadShiftCount;
+            result = Value::integer(static_cast<int64_t>(static_cast<uint64_t>(a) << b));
+            return NumericResult::Ok;
+        case BIN_SRIGHT:
+            if (b < 0 || b > 63) return NumericResult::BadShiftCount;
+            result = Value::integer(a >> b);
+            return NumericResult::Ok;
+        default:
+            return NumericResult::NotNumeric;
+    }
+}
+
+// Applies a comparison to an order from Value::compareNumbers
+inline bool orderSatisfies(TokenType op, int order) {
+    switch (op) {
+        case GREATER: return order == 1;
+        case GREATER_EQUAL: return order == 0 || order == 1;
+        case LESS: return order == -1;
+        case LESS_EQUAL: return order == -1 || order == 0;
+        case DOUBLE_EQUAL: return order == 0;
+        default: return order != 0;  // BANG_EQUAL
+    }
+}
+
+// Comparisons of two numbers, exact when an integer meets a double. False
+// for any other operator.
+inline bool orderedComparison(TokenType op, const Value& left, const Value& right, Value& result) {
+    switch (op) {
+        case GREATER:
+        case GREATER_EQUAL:
+        case LESS:
+        case LESS_EQUAL:
+        case DOUBLE_EQUAL:
+        case BANG_EQUAL:
+            result = Value(orderSatisfies(op, Value::compareNumbers(left, right)));
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Both operands must be numbers. Leaves result alone unless it returns Ok.
+inline NumericResult numberBinary(TokenType op, const Value& left, const Value& right, Value& result) {
+    if (left.isInteger() && right.isInteger()) {
+        return integerBinary(op, left.asInteger(), right.asInteger(), result);
+    }
+
+    switch (op) {
+        case BIN_AND:
+        case BIN_OR:
+        case BIN_XOR:
+        case BIN_SLEFT:
+        case BIN_SRIGHT: {
+            int64_t a, b;
+            if (!toBitwiseOperand(left, a) || !toBitwiseOperand(right, b)) return NumericResult::NotAnInteger;
+            return integerBinary(op, a, b, result);
+        }
+        default:
+            break;
+    }
+
+    if (orderedComparison(op, left, right, result)) return NumericResult::Ok;
+
+    double a = left.asNumber();
+    double b = right.asNumber();
+    switch (op) {
+        case PLUS: result = Value(a + b); return NumericResult::Ok;
+        case MINUS: result = Value(a - b); return NumericResult::Ok;
+        case STAR: result = Value(a * b); return NumericResult::Ok;
+        case SLASH:
+            if (b == 0) return NumericResult::DivideByZero;
+            result = Value(a / b);
+            return NumericResult::Ok;
+        case PERCENT:
+            if (b == 0) return NumericResult::ModuloByZero;
+            result = Value(std::fmod(a, b));
+            return NumericResult::Ok;
+        default: return NumericResult::NotNumeric;
+    }
+}
+
+// Unary minus and ~ on a number; false for an operand ~ cannot take
+inline bool numberUnary(TokenType op, const Value& operand, Value& result) {
+    if (op == MINUS) {
+        if (operand.isInteger() && operand.asInteger() != INT64_MIN) {
+            result = Value::integer(-operand.asInteger());
+        } else {
+            result = Value(-operand.asNumber());
+        }
+        return true;
+    }
+    int64_t bits;
+    if (op != BIN_NOT || !toBitwiseOperand(operand, bits)) return false;
+    result = Value::integer(~bits);
+    return true;
+}
+
+// ++ and --
+inline Value numberStep(const Value& operand, int64_t step) {
+    int64_t out;
+    if (operand.isInteger() && !__builtin_add_overflow(operand.asInteger(), step, &out)) {
+        return Value::integer(out);
+    }
+    return Value(operand.asNumber() + static_cast<double>(step));
+}
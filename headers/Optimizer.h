@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include "Expression.h"
+#include "Statement.h"
+#include "AstArena.h"
+
+// AST optimization pass run after parsing and before the Resolver, so code
+// it removes never takes a slot. It folds operators whose operands are
+// literals (only where the runtime could not raise an error), resolves
+// and/or with a literal left operand, prunes if
+// statements with a constant condition and drops statements after a return
+// inside a function body. Nodes are rewritten in place; new literals are
+// allocated in the program's arena.
+class Optimizer final : public ExprVisitor, public StmtVisitor {
+public:
+    explicit Optimizer(AstArena& arena) : arena(arena) {}
+
+    void optimize(std::vector<Stmt*>& statements);
+
+    Value visitAssignExpr(AssignExpr& expression) override;
+    Value visitBinaryExpr(BinaryExpr& expression) override;
+    Value visitCallExpr(CallExpr& expression) override;
+    Value visitFunctionExpr(FunctionExpr& expression) override;
+    Value visitGroupingExpr(GroupingExpr& expression) override;
+    Value visitIncrementExpr(IncrementExpr& expression) override;
+    Value visitLiteralExpr(LiteralExpr& expression) override;
+    Value visitLogicalExpr(LogicalExpr& expression) override;
+    Value visitUnaryExpr(UnaryExpr& expression) override;
+    Value visitVarExpr(VarExpr& expression) override;
+
+    void visitBlockStmt(BlockStmt& statement, ExecutionContext* context = nullptr) override;
+    void visitExpressionStmt(ExpressionStmt& statement, ExecutionContext* context = nullptr) override;
+    void visitVarStmt(VarStmt& statement, ExecutionContext* context = nullptr) override;
+    void visitFunctionStmt(FunctionStmt& statement, ExecutionContext* context = nullptr) override;
+    void visitReturnStmt(ReturnStmt& statement, ExecutionContext* context = nullptr) override;
+    void visitIfStmt(IfStmt& statement, ExecutionContext* context = nullptr) override;
+
+private:
+    AstArena& arena;
+    int functionDepth = 0;
+
+    // Results of the node being visited: a replacement expression or
+    // statement, or a request to remove the statement altogether
+    Expr* replacement = nullptr;
+    Stmt* statementReplacement = nullptr;
+    bool removeStatement = false;
+
+    Expr* fold(Expr* expression);
+    Stmt* optimizeStatement(Stmt* statement);  // nullptr when the statement was removed
+    void optimizeBody(std::vector<Stmt*>& statements);
+
+    static bool foldBinary(const Token& oper, const Value& left, const Value& right, Value& result);
+    static bool foldUnary(const Token& oper, const Value& right, Value& result);
+    static bool isTruthy(const Value& value);
+};
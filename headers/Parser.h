@@ -7,34 +7,36 @@
 #include "TypeWrapper.h"
 #include "helperFunctions/ShortHands.h"
 #include "ErrorReporter.h"
+#include "AstArena.h"
 
 class Parser
 {
 private:
     const std::vector<Token> tokens;
+    AstArena& arena;
     int current = 0;
     int functionDepth = 0; // Track nesting level of functions
     ErrorReporter* errorReporter = nullptr;
 
 public:
-    explicit Parser(std::vector<Token> tokens) : tokens(std::move(tokens)){};
-    std::vector<sptr(Stmt)> parse();
+    Parser(std::vector<Token> tokens, AstArena& arena) : tokens(std::move(tokens)), arena(arena){};
+    std::vector<Stmt*> parse();
     void setErrorReporter(ErrorReporter* reporter) { errorReporter = reporter; }
 
 private:
-    sptr(Expr) expression();
-    sptr(Expr) logical_or();
-    sptr(Expr) logical_and();
-    sptr(Expr) bitwise_or();
-    sptr(Expr) bitwise_xor();
-    sptr(Expr) bitwise_and();
-    sptr(Expr) shift();
-    sptr(Expr) equality();
-    sptr(Expr) comparison();
-    sptr(Expr) term();
-    sptr(Expr) factor();
-    sptr(Expr) unary();
-    sptr(Expr) primary();
+    Expr* expression();
+    Expr* logical_or();
+    Expr* logical_and();
+    Expr* bitwise_or();
+    Expr* bitwise_xor();
+    Expr* bitwise_and();
+    Expr* shift();
+    Expr* equality();
+    Expr* comparison();
+    Expr* term();
+    Expr* factor();
+    Expr* unary();
+    Expr* primary();
 
     bool match(const std::vector<TokenType>& types);
 
@@ -44,38 +46,41 @@ private:
     Token peek();
     Token previous();
     Token consume(TokenType type, const std::string& message);
-    sptr(Stmt) statement();
+    Stmt* statement();
 
     void sync();
 
 
 
-    std::shared_ptr<Stmt> expressionStatement();
+    Stmt* expressionStatement();
 
-    std::shared_ptr<Stmt> returnStatement();
+    Stmt* returnStatement();
 
-    std::shared_ptr<Stmt> ifStatement();
+    Stmt* ifStatement();
 
-    std::shared_ptr<Stmt> declaration();
+    Stmt* declaration();
 
-    std::shared_ptr<Stmt> varDeclaration();
+    Stmt* varDeclaration();
 
-    std::shared_ptr<Stmt> functionDeclaration();
-    std::shared_ptr<Expr> functionExpression();
+    Stmt* functionDeclaration();
+    Expr* functionExpression();
 
-    sptr(Expr) assignment();
-    sptr(Expr) increment();  // Parse increment/decrement expressions
-    sptr(Expr) postfix();    // Parse postfix operators
+    Expr* assignment();
+    Expr* increment();  // Parse increment/decrement expressions
+    Expr* postfix();    // Parse postfix operators
 
-    std::vector<std::shared_ptr<Stmt>> block();
+    std::vector<Stmt*> block();
     
-    sptr(Expr) finishCall(sptr(Expr) callee);
+    Expr* finishCall(Expr* callee);
     
     // Helper methods for function scope tracking
     void enterFunction() { functionDepth++; }
     void exitFunction() { functionDepth--; }
     bool isInFunction() const { return functionDepth > 0; }
     
+    template<typename T, typename... Args>
+    T* make(Args&&... args) { return arena.make<T>(std::forward<Args>(args)...); }
+
     // Helper method for tail call detection
-    bool isTailCall(const std::shared_ptr<Expr>& expr);
+    bool isTailCall(Expr* expr);
 };
\ No newline at end of file
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Per-function profiler enabled with --profile. Both execution engines report
+// every call of a user function or builtin through enter/exit; the profiler
+// keeps a shadow call stack, accumulates call counts and self/total time per
+// function name, and records self time per distinct call path so it can emit
+// collapsed stacks for flamegraph.pl. Engines hold a null Profiler* when
+// profiling is off, so the only cost then is a pointer test per call.
+class Profiler {
+public:
+    Profiler();
+
+    void enter(const std::string& name);
+    void exit();
+
+    // A tail call replaces the innermost frame instead of nesting under it
+    void tailCall(const std::string& name) {
+        exit();
+        enter(name);
+    }
+
+    // Close every frame above the script root, e.g. after a runtime error
+    // abandoned them
+    void unwind();
+
+    // Per-function table sorted by self time
+    void report(std::ostream& out);
+
+    // One "root;caller;callee microseconds" line per call path
+    void writeCollapsed(std::ostream& out);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct FunctionStats {
+        std::string name;
+        uint64_t calls = 0;
+        int64_t selfNs = 0;
+        int64_t totalNs = 0;  // counted for outermost activations only, so recursion is not double counted
+        int active = 0;
+    };
+
+    struct Node {
+        int function;
+        int parent;
+        int64_t selfNs = 0;
+        std::unordered_map<int, int> children;  // function id -> node
+    };
+
+    struct Frame {
+        int node;
+        Clock::time_point start;
+        int64_t childNs;
+    };
+
+    std::vector<FunctionStats> functions;
+    std::unordered_map<std::string, int> functionIds;
+    std::vector<Node> nodes;
+    std::vector<Frame> stack;
+
+    int functionId(const std::string& name);
+    void finish();
+};
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include "Lexer.h"
+#include "Value.h"
+#include "Numeric.h"
+
+// Operand-type specializations for operator sites. A BinaryExpr/UnaryExpr
+// (or the matching bytecode instruction) starts Unspecialized, takes the
+// generic path once and specializes on the operand types it saw. A later
+// evaluation with other types drops the site to Generic for good, so
+// polymorphic sites do not flip back and forth. Two integers get the
+// Integers forms and any other pair of numbers the Numbers forms; both
+// compute exactly what numberBinary (Numeric.h) does.
+enum class QuickOp : uint8_t {
+    Unspecialized,
+    Generic,
+
+    AddNumbers,
+    SubtractNumbers,
+    MultiplyNumbers,
+    DivideNumbers,      // falls back on a zero divisor so the generic path reports it
+    ModuloNumbers,      // likewise
+    LessNumbers,
+    LessEqualNumbers,
+    GreaterNumbers,
+    GreaterEqualNumbers,
+    EqualNumbers,
+    NotEqualNumbers,
+
+    AddIntegers,
+    SubtractIntegers,
+    MultiplyIntegers,
+    DivideIntegers,     // falls back on a zero divisor
+    ModuloIntegers,     // likewise
+    LessIntegers,
+    LessEqualIntegers,
+    GreaterIntegers,
+    GreaterEqualIntegers,
+    EqualIntegers,
+    NotEqualIntegers,
+    BitAndIntegers,
+    BitOrIntegers,
+    BitXorIntegers,
+    ShiftLeftIntegers,  // falls back on a count outside 0..63
+    ShiftRightIntegers, // likewise
+
+    ConcatStrings,
+    EqualStrings,
+    NotEqualStrings,
+
+    NegateNumber
+};
+
+// Whether a Numbers form applies to the operands
+inline bool mixedOrDoubles(const Value& left, const Value& right) {
+    if (left.isDouble()) return right.isNumber();
+    return left.isInteger() && right.isDouble();
+}
+
+inline QuickOp quickenBinary(TokenType op, const Value& left, const Value& right) {
+    if (left.isInteger() && right.isInteger()) {
+        switch (op) {
+            case PLUS: return QuickOp::AddIntegers;
+            case MINUS: return QuickOp::SubtractIntegers;
+            case STAR: return QuickOp::MultiplyIntegers;
+            case SLASH: return QuickOp::DivideIntegers;
+            case PERCENT: return QuickOp::ModuloIntegers;
+            case LESS: return QuickOp::LessIntegers;
+            case LESS_EQUAL: return QuickOp::LessEqualIntegers;
+            case GREATER: return QuickOp::GreaterIntegers;
+            case GREATER_EQUAL: return QuickOp::GreaterEqualIntegers;
+            case DOUBLE_EQUAL: return QuickOp::EqualIntegers;
+            case BANG_EQUAL: return QuickOp::NotEqualIntegers;
+            case BIN_AND: return QuickOp::BitAndIntegers;
+            case BIN_OR: return QuickOp::BitOrIntegers;
+            case BIN_XOR: return QuickOp::BitXorIntegers;
+            case BIN_SLEFT: return QuickOp::ShiftLeftIntegers;
+            case BIN_SRIGHT: return QuickOp::ShiftRightIntegers;
+            default: return QuickOp::Generic;
+        }
+    }
+    if (mixedOrDoubles(left, right)) {
+        switch (op) {
+            case PLUS: return QuickOp::AddNumbers;
+            case MINUS: return QuickOp::SubtractNumbers;
+            case STAR: return QuickOp::MultiplyNumbers;
+            case SLASH: return QuickOp::DivideNumbers;
+            case PERCENT: return QuickOp::ModuloNumbers;
+            case LESS: return QuickOp::LessNumbers;
+            case LESS_EQUAL: return QuickOp::LessEqualNumbers;
+            case GREATER: return QuickOp::GreaterNumbers;
+            case GREATER_EQUAL: return QuickOp::GreaterEqualNumbers;
+            case DOUBLE_EQUAL: return QuickOp::EqualNumbers;
+            case BANG_EQUAL: return QuickOp::NotEqualNumbers;
+            default: return QuickOp::Generic;
+        }
+    }
+    if (left.isString() && right.isString()) {
+        switch (op) {
+            case PLUS: return QuickOp::ConcatStrings;
+            case DOUBLE_EQUAL: return QuickOp::EqualStrings;
+            case BANG_EQUAL: return QuickOp::NotEqualStrings;
+            default: return QuickOp::Generic;
+        }
+    }
+    return QuickOp::Generic;
+}
+
+inline QuickOp quickenUnary(TokenType op, const Value& right) {
+    if (op == MINUS && right.isNumber()) return QuickOp::NegateNumber;  // see numberUnary
+    return QuickOp::Generic;
+}
+
+// The operator an Integers form specializes
+constexpr TokenType integerToken(QuickOp op) {
+    switch (op) {
+        case QuickOp::AddIntegers: return PLUS;
+        case QuickOp::SubtractIntegers: return MINUS;
+        case QuickOp::MultiplyIntegers: return STAR;
+        case QuickOp::DivideIntegers: return SLASH;
+        case QuickOp::ModuloIntegers: return PERCENT;
+        case QuickOp::LessIntegers: return LESS;
+        case QuickOp::LessEqualIntegers: return LESS_EQUAL;
+        case QuickOp::GreaterIntegers: return GREATER;
+        case QuickOp::GreaterEqualIntegers: return GREATER_EQUAL;
+        case QuickOp::EqualIntegers: return DOUBLE_EQUAL;
+        case QuickOp::NotEqualIntegers: return BANG_EQUAL;
+        case QuickOp::BitAndIntegers: return BIN_AND;
+        case QuickOp::BitOrIntegers: return BIN_OR;
+        case QuickOp::BitXorIntegers: return BIN_XOR;
+        case QuickOp::ShiftLeftIntegers: return BIN_SLEFT;
+        case QuickOp::ShiftRightIntegers: return BIN_SRIGHT;
+        default: return END_OF_FILE;
+    }
+}
+
+// Operation of an Integers form, computed by integerBinary. False for the
+// errors, which are left to the generic path to report.
+inline bool quickIntegers(QuickOp op, int64_t a, int64_t b, Value& result) {
+    return integerBinary(integerToken(op), a, b, result) == NumericResult::Ok;
+}
+
+// Runs a specialized binary operation. Returns false without touching result
+// when the operands do not match the specialization.
+inline bool quickBinary(QuickOp op, const Value& left, const Value& right, Value& result) {
+    if (op >= QuickOp::AddIntegers && op <= QuickOp::ShiftRightIntegers) {
+        if (!left.isInteger() || !right.isInteger()) return false;
+        return quickIntegers(op, left.asInteger(), right.asInteger(), result);
+    }
+
+    if (op >= QuickOp::AddNumbers && op <= QuickOp::NotEqualNumbers) {
+        if (!mixedOrDoubles(left, right)) return false;
+        double a = left.asNumber();
+        double b = right.asNumber();
+        switch (op) {
+            case QuickOp::AddNumbers: result = Value(a + b); return true;
+            case QuickOp::SubtractNumbers: result = Value(a - b); return true;
+            case QuickOp::MultiplyNumbers: result = Value(a * b); return true;
+            case QuickOp::DivideNumbers:
+                if (b == 0) return false;
+                result = Value(a / b);
+                return true;
+            case QuickOp::ModuloNumbers:
+                if (b == 0) return false;
+                result = Value(std::fmod(a, b));
+                return true;
+            case QuickOp::LessNumbers: result = Value(orderSatisfies(LESS, Value::compareNumbers(left, right))); return true;
+            case QuickOp::LessEqualNumbers: result = Value(orderSatisfies(LESS_EQUAL, Value::compareNumbers(left, right))); return true;
+            case QuickOp::GreaterNumbers: result = Value(orderSatisfies(GREATER, Value::compareNumbers(left, right))); return true;
+            case QuickOp::GreaterEqualNumbers: result = Value(orderSatisfies(GREATER_EQUAL, Value::compareNumbers(left, right))); return true;
+            case QuickOp::EqualNumbers: result = Value(orderSatisfies(DOUBLE_EQUAL, Value::compareNumbers(left, right))); return true;
+            case QuickOp::NotEqualNumbers: result = Value(orderSatisfies(BANG_EQUAL, Value::compareNumbers(left, right))); return true;
+            default: return false;
+        }
+    }
+
+    if (!left.isString() || !right.isString()) return false;
+    switch (op) {
+        case QuickOp::ConcatStrings: result = Value::concat(left, right); return true;
+        case QuickOp::EqualStrings: result = Value(left.equals(right)); return true;
+        case QuickOp::NotEqualStrings: result = Value(!left.equals(right)); return true;
+        default: return false;
+    }
+}
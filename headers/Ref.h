@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Single-threaded intrusive reference. The count lives in the object itself
+// (a `refCount` member) and is updated without atomics; when the last Ref
+// goes away the object is handed to `T::destroy`, which may recycle it
+// instead of deleting it. Members are only instantiated where they are used,
+// so T may be incomplete where a Ref<T> is merely declared.
+template<typename T>
+class Ref {
+public:
+    Ref() = default;
+    Ref(std::nullptr_t) {}
+    explicit Ref(T* object) : ptr(object) { retain(); }
+    Ref(const Ref& other) : ptr(other.ptr) { retain(); }
+    Ref(Ref&& other) noexcept : ptr(other.ptr) { other.ptr = nullptr; }
+    ~Ref() { release(); }
+
+    Ref& operator=(const Ref& other) {
+        T* old = ptr;
+        ptr = other.ptr;
+        retain();
+        if (old && --old->refCount == 0) {
+            T::destroy(old);
+        }
+        return *this;
+    }
+
+    Ref& operator=(Ref&& other) noexcept {
+        if (this != &other) {
+            T* old = ptr;
+            ptr = other.ptr;
+            other.ptr = nullptr;
+            if (old && --old->refCount == 0) {
+                T::destroy(old);
+            }
+        }
+        return *this;
+    }
+
+    Ref& operator=(std::nullptr_t) {
+        release();
+        ptr = nullptr;
+        return *this;
+    }
+
+    T* get() const { return ptr; }
+    T* operator->() const { return ptr; }
+    T& operator*() const { return *ptr; }
+    explicit operator bool() const { return ptr != nullptr; }
+    bool operator==(const Ref& other) const { return ptr == other.ptr; }
+    bool operator!=(const Ref& other) const { return ptr != other.ptr; }
+
+    uint32_t useCount() const { return ptr ? ptr->refCount : 0; }
+
+private:
+    T* ptr = nullptr;
+
+    void retain() const {
+        if (ptr) ptr->refCount++;
+    }
+
+    void release() {
+        if (ptr && --ptr->refCount == 0) {
+            T* dead = ptr;
+            ptr = nullptr;
+            T::destroy(dead);
+        }
+    }
+};
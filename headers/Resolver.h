@@ -0,0 +1,92 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Expression.h"
+#include "Statement.h"
+
+// Static scope resolution pass run between parsing and execution.
+// Annotates every local variable reference with a (depth, slot) pair so the
+// runtime can index a dense slot array instead of hashing names. Depth counts
+// runtime scopes, which are fewer than lexical ones: a function's blocks keep
+// their variables in the function's frame (without loops a block runs at
+// most once per call), and at the top level only the outermost block that
+// declares something gets a scope. A variable
+// of an enclosing function becomes an upvalue of the referencing function,
+// recorded in its prototype's capture list (and in the lists of the functions
+// in between). Names that are not found in any enclosing scope stay globals.
+// A variable declared after a closure is created does not exist yet when the
+// closure runs early, so its upvalue falls back to what the name means further
+// out (see FunctionPrototype::Capture) until the declaration has run.
+class Resolver final : public ExprVisitor, public StmtVisitor {
+public:
+    void resolve(const std::vector<Stmt*>& statements);
+
+    Value visitAssignExpr(AssignExpr& expression) override;
+    Value visitBinaryExpr(BinaryExpr& expression) override;
+    Value visitCallExpr(CallExpr& expression) override;
+    Value visitFunctionExpr(FunctionExpr& expression) override;
+    Value visitGroupingExpr(GroupingExpr& expression) override;
+    Value visitIncrementExpr(IncrementExpr& expression) override;
+    Value visitLiteralExpr(LiteralExpr& expression) override;
+    Value visitLogicalExpr(LogicalExpr& expression) override;
+    Value visitUnaryExpr(UnaryExpr& expression) override;
+    Value visitVarExpr(VarExpr& expression) override;
+
+    void visitBlockStmt(BlockStmt& statement, ExecutionContext* context = nullptr) override;
+    void visitExpressionStmt(ExpressionStmt& statement, ExecutionContext* context = nullptr) override;
+    void visitVarStmt(VarStmt& statement, ExecutionContext* context = nullptr) override;
+    void visitFunctionStmt(FunctionStmt& statement, ExecutionContext* context = nullptr) override;
+    void visitReturnStmt(ReturnStmt& statement, ExecutionContext* context = nullptr) override;
+    void visitIfStmt(IfStmt& statement, ExecutionContext* context = nullptr) override;
+
+private:
+    struct Local {
+        int slot;
+        int order;            // declarations in the scope before this one
+    };
+
+    struct Scope {
+        std::unordered_map<Symbol, Local> locals;
+        int declared = 0;     // names declared so far
+        int slotCount = 0;    // slots taken in this scope's storage
+        size_t function = 0;  // nesting level of the function owning the scope; 0 is the script
+        bool hasStorage;      // a runtime scope; variables of other scopes go to the enclosing one
+    };
+
+    // Function bodies are resolved after their enclosing function (or the
+    // program) has been resolved, so they see every variable of the
+    // surrounding scopes, including later ones such as a mutually recursive
+    // local function. visible records which of them already exist when the
+    // function is created.
+    struct PendingFunction {
+        const std::vector<Token>* params;
+        const std::vector<Stmt*>* body;
+        FunctionPrototype* prototype;  // completed once the body is resolved
+        std::vector<std::shared_ptr<Scope>> scopes;
+        std::vector<int> visible;
+        std::vector<FunctionPrototype*> functions;
+    };
+
+    std::vector<std::shared_ptr<Scope>> scopes;
+    std::vector<int> visible;  // per scope: variables declared before this order exist
+    std::vector<FunctionPrototype*> functions;  // enclosing functions, outermost first
+    std::vector<PendingFunction>* pending = nullptr;
+
+    void resolve(Stmt* statement);
+    void resolve(Expr* expression);
+    void resolveFunction(const PendingFunction& function);
+    void deferFunction(const std::vector<Token>& params, const std::vector<Stmt*>& body, FunctionPrototype& prototype);
+    void resolvePending(std::vector<PendingFunction>& functions);
+    void resolveLocal(const Token& name, int& depth, int& slot, int& upvalue);
+    int captureOuter(Symbol name, int scopeIndex);
+    int capture(size_t level, size_t scopeIndex, int slot, int fallback);
+
+    void beginScope(bool hasStorage);
+    int endScope();
+    Scope* storage();
+    int declare(const Token& name);
+    int depthBetween(size_t scopeIndex, size_t innermost) const;
+};
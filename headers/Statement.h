@@ -1,120 +1,159 @@
-#pragma once
-
+// Generated by tools/GenerateAST. Edit the node list in tools/GenerateAST.cpp
+// and run `make ast` instead of changing this file by hand.
 
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
 #include "helperFunctions/ShortHands.h"
 #include "TypeWrapper.h"
 #include "Expression.h"
 
+struct ExecutionContext {
+    bool isFunctionBody = false;
+    bool hasReturn = false;
+    Value returnValue;
+    // Pending tail call: the caller's trampoline reuses its frame to run it.
+    // The callee and its arguments are on top of the interpreter's call stack.
+    Function* tailCallee = nullptr;
+    size_t tailArgumentCount = 0;
+};
+
+struct BlockStmt;
 struct ExpressionStmt;
 struct VarStmt;
-struct BlockStmt;
 struct FunctionStmt;
 struct ReturnStmt;
 struct IfStmt;
 
-struct ExecutionContext {
-    bool isFunctionBody = false;
-    bool hasReturn = false;
-    Value returnValue;
+enum class StmtKind : uint8_t {
+    Block,
+    Expression,
+    Var,
+    Function,
+    Return,
+    If
 };
 
+// Every visitor implements one method per node type
 struct StmtVisitor
 {
-    virtual void visitBlockStmt(const std::shared_ptr<BlockStmt>& stmt, ExecutionContext* context = nullptr) = 0;
-    virtual void visitExpressionStmt(const std::shared_ptr<ExpressionStmt>& stmt, ExecutionContext* context = nullptr) = 0;
-    virtual void visitVarStmt(const std::shared_ptr<VarStmt>& stmt, ExecutionContext* context = nullptr) = 0;
-    virtual void visitFunctionStmt(const std::shared_ptr<FunctionStmt>& stmt, ExecutionContext* context = nullptr) = 0;
-    virtual void visitReturnStmt(const std::shared_ptr<ReturnStmt>& stmt, ExecutionContext* context = nullptr) = 0;
-    virtual void visitIfStmt(const std::shared_ptr<IfStmt>& stmt, ExecutionContext* context = nullptr) = 0;
+    virtual void visitBlockStmt(BlockStmt& stmt, ExecutionContext* context = nullptr) = 0;
+    virtual void visitExpressionStmt(ExpressionStmt& stmt, ExecutionContext* context = nullptr) = 0;
+    virtual void visitVarStmt(VarStmt& stmt, ExecutionContext* context = nullptr) = 0;
+    virtual void visitFunctionStmt(FunctionStmt& stmt, ExecutionContext* context = nullptr) = 0;
+    virtual void visitReturnStmt(ReturnStmt& stmt, ExecutionContext* context = nullptr) = 0;
+    virtual void visitIfStmt(IfStmt& stmt, ExecutionContext* context = nullptr) = 0;
 };
 
-struct Stmt : public std::enable_shared_from_this<Stmt>
+// AST nodes are owned by an AstArena and link to each other with plain
+// pointers. The base only holds the node's kind: nodes have no vtable.
+struct Stmt
 {
-    std::shared_ptr<Expr> expression;
-    virtual void accept(StmtVisitor* visitor, ExecutionContext* context = nullptr) = 0;
-    virtual ~Stmt(){};
+    const StmtKind kind;
+
+protected:
+    explicit Stmt(StmtKind kind) : kind(kind) {}
 };
 
 struct BlockStmt : Stmt
 {
-    std::vector<std::shared_ptr<Stmt> > statements;
-    explicit BlockStmt(std::vector<std::shared_ptr<Stmt> > statements) : statements(statements)
-    {
-    }
-    void accept(StmtVisitor* visitor, ExecutionContext* context = nullptr) override
-    {
-        visitor->visitBlockStmt(std::static_pointer_cast<BlockStmt>(shared_from_this()), context);
-    }
+    static constexpr StmtKind KIND = StmtKind::Block;
+
+    std::vector<Stmt*> statements;
+    // Set by the Resolver: whether the block runs in a scope of its own,
+    // sized slotCount. Otherwise its variables, if any, take slots in the
+    // enclosing frame or scope.
+    bool hasScope = true;
+    int slotCount = 0;
+
+    explicit BlockStmt(std::vector<Stmt*> statements)
+        : Stmt(KIND), statements(std::move(statements)) {}
 };
 
 struct ExpressionStmt : Stmt
 {
-    std::shared_ptr<Expr> expression;
-    explicit ExpressionStmt(std::shared_ptr<Expr> expression) : expression(expression)
-    {
-    }
-
-    void accept(StmtVisitor* visitor, ExecutionContext* context = nullptr) override
-    {
-        visitor->visitExpressionStmt(std::static_pointer_cast<ExpressionStmt>(shared_from_this()), context);
-    }
-};
+    static constexpr StmtKind KIND = StmtKind::Expression;
 
+    Expr* expression;
 
+    explicit ExpressionStmt(Expr* expression)
+        : Stmt(KIND), expression(expression) {}
+};
 
 struct VarStmt : Stmt
 {
+    static constexpr StmtKind KIND = StmtKind::Var;
+
     Token name;
-    std::shared_ptr<Expr> initializer;
-    VarStmt(Token name, std::shared_ptr<Expr> initializer) : name(name), initializer(initializer)
-    {
-    }
+    Expr* initializer;
+    int slot = -1;  // set by the Resolver; -1 defines a global by name
 
-    void accept(StmtVisitor* visitor, ExecutionContext* context = nullptr) override
-    {
-        visitor->visitVarStmt(std::static_pointer_cast<VarStmt>(shared_from_this()), context);
-    }
+    VarStmt(Token name, Expr* initializer)
+        : Stmt(KIND), name(name), initializer(initializer) {}
 };
 
 struct FunctionStmt : Stmt
 {
+    static constexpr StmtKind KIND = StmtKind::Function;
+
     const Token name;
     const std::vector<Token> params;
-    std::vector<std::shared_ptr<Stmt> > body;
-
-    FunctionStmt(Token name, std::vector<Token> params, std::vector<std::shared_ptr<Stmt> > body) 
-        : name(name), params(params), body(body) {}
+    std::vector<Stmt*> body;
+    int slot = -1;  // set by the Resolver; -1 defines a global by name
+    FunctionPrototype prototype{std::string(name.lexeme)};  // completed by the Resolver
 
-    void accept(StmtVisitor* visitor, ExecutionContext* context = nullptr) override
-    {
-        visitor->visitFunctionStmt(std::static_pointer_cast<FunctionStmt>(shared_from_this()), context);
-    }
+    FunctionStmt(Token name, std::vector<Token> params, std::vector<Stmt*> body)
+        : Stmt(KIND), name(name), params(std::move(params)), body(std::move(body)) {}
 };
 
 struct ReturnStmt : Stmt
 {
-    const Token keyword;
-    std::shared_ptr<Expr> value;
+    static constexpr StmtKind KIND = StmtKind::Return;
 
-    ReturnStmt(Token keyword, std::shared_ptr<Expr> value) : keyword(keyword), value(value) {}
+    const Token keyword;
+    Expr* value;
 
-    void accept(StmtVisitor* visitor, ExecutionContext* context = nullptr) override
-    {
-        visitor->visitReturnStmt(std::static_pointer_cast<ReturnStmt>(shared_from_this()), context);
-    }
+    ReturnStmt(Token keyword, Expr* value)
+        : Stmt(KIND), keyword(keyword), value(value) {}
 };
 
 struct IfStmt : Stmt
 {
-    std::shared_ptr<Expr> condition;
-    std::shared_ptr<Stmt> thenBranch;
-    std::shared_ptr<Stmt> elseBranch;
+    static constexpr StmtKind KIND = StmtKind::If;
+
+    Expr* condition;
+    Stmt* thenBranch;
+    Stmt* elseBranch;
+    LogicalExpr* logicalCondition = nullptr;  // condition, when it is an and/or chain
 
-    IfStmt(std::shared_ptr<Expr> condition, std::shared_ptr<Stmt> thenBranch, std::shared_ptr<Stmt> elseBranch) 
-        : condition(condition), thenBranch(thenBranch), elseBranch(elseBranch) {}
+    IfStmt(Expr* condition, Stmt* thenBranch, Stmt* elseBranch)
+        : Stmt(KIND), condition(condition), thenBranch(thenBranch), elseBranch(elseBranch) { setCondition(condition); }
 
-    void accept(StmtVisitor* visitor, ExecutionContext* context = nullptr) override
-    {
-        visitor->visitIfStmt(std::static_pointer_cast<IfStmt>(shared_from_this()), context);
+    void setCondition(Expr* expression) {
+        condition = expression;
+        logicalCondition = LogicalExpr::from(expression);
+    }
+};
+
+// Calls the visit method for the node's kind. With a final visitor class
+// the call is direct, so a visit costs one switch and no virtual calls.
+template<typename Visitor>
+inline void visitStmt(Visitor& visitor, Stmt& node, ExecutionContext* context)
+{
+    switch (node.kind) {
+        case StmtKind::Block:
+            return visitor.visitBlockStmt(static_cast<BlockStmt&>(node), context);
+        case StmtKind::Expression:
+            return visitor.visitExpressionStmt(static_cast<ExpressionStmt&>(node), context);
+        case StmtKind::Var:
+            return visitor.visitVarStmt(static_cast<VarStmt&>(node), context);
+        case StmtKind::Function:
+            return visitor.visitFunctionStmt(static_cast<FunctionStmt&>(node), context);
+        case StmtKind::Return:
+            return visitor.visitReturnStmt(static_cast<ReturnStmt&>(node), context);
+        case StmtKind::If:
+            return visitor.visitIfStmt(static_cast<IfStmt&>(node), context);
     }
-};
\ No newline at end of file
+    __builtin_unreachable();
+}
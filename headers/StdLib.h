@@ -9,5 +9,5 @@ class ErrorReporter;
 
 class StdLib {
 public:
-    static void addToEnvironment(std::shared_ptr<Environment> env, Interpreter& interpreter, ErrorReporter* errorReporter = nullptr);
+    static void addToEnvironment(const EnvironmentRef& env, Interpreter& interpreter, ErrorReporter* errorReporter = nullptr);
 }; 
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// Interned identifier. The Lexer gives every IDENTIFIER token the symbol of
+// its name, so code that keys on names (the Resolver's scopes, the global
+// environment) compares and hashes a small integer instead of the string.
+// Symbols are dense and never released, which keeps them valid across REPL
+// lines and makes the integer itself a collision-free hash.
+using Symbol = uint32_t;
+
+constexpr Symbol NO_SYMBOL = UINT32_MAX;  // tokens other than identifiers
+
+namespace SymbolTable {
+    Symbol intern(std::string_view name);
+    std::string_view name(Symbol symbol);
+}
@@ -5,10 +5,13 @@
 #include <memory>
 #include <functional>
 #include "Value.h"
+#include "Ref.h"
 
 // Forward declarations
 struct Stmt;
-struct Environment;
+class Environment;
+using EnvironmentRef = Ref<Environment>;
+struct Chunk;
 
 struct Object
 {
@@ -41,25 +44,105 @@ struct None : public Object
 
 };
 
+// The immutable part of a function: one per declaration or function
+// expression, shared by every closure created from it. It lives in the
+// declaring AST node; the Resolver fills it in and the Compiler attaches
+// the compiled body.
+struct FunctionPrototype
+{
+    std::string name;
+    std::vector<std::string> params;
+    std::vector<Stmt*> body;
+    int slotCount = 0;  // size of the call frame: params followed by locals
+    std::shared_ptr<Chunk> chunk;  // compiled body, when run by the VM
+
+    // Where a new closure finds each of its upvalues: a slot in the scope
+    // chain it is created in (depth levels up), or an upvalue of the
+    // function creating it
+    struct Capture {
+        bool isLocal;
+        int depth;
+        int index;  // slot when isLocal, otherwise the enclosing function's upvalue
+        // For a variable declared after the closure is created: the upvalue
+        // that stands in for it until the declaration runs, or FALLBACK_GLOBAL
+        int fallback = NO_FALLBACK;
+    };
+    static constexpr int NO_FALLBACK = -2;
+    static constexpr int FALLBACK_GLOBAL = -1;
+    std::vector<Capture> upvalues;
+    // Whether a closure created in a call captures a slot of the call's
+    // frame. Frames nobody captures keep their slots on the value stack
+    // instead of in an Environment.
+    bool frameCaptured = false;
+
+    explicit FunctionPrototype(std::string name) : name(std::move(name)) {}
+};
+
+// A variable captured by closures. While the scope declaring it runs, the
+// upvalue is open and points at the variable's slot there; when the scope
+// ends it is closed and the value moves into the upvalue itself.
+struct Upvalue
+{
+    uint32_t refCount = 0;
+    Value* location;              // the slot while open, &closed afterwards
+    Value closed;
+    Environment* scope;           // declaring scope while open, nullptr once closed
+    Upvalue* prevOpen = nullptr;  // links in the scope's list of open upvalues
+    Upvalue* nextOpen = nullptr;
+
+    Upvalue(Value* slot, Environment* scope) : location(slot), scope(scope) {}
+    Value& value() { return *location; }
+
+    // Called by UpvalueRef when the last closure using it goes away
+    static void destroy(Upvalue* upvalue);
+};
+using UpvalueRef = Ref<Upvalue>;
+
+// A closure: a prototype plus the variables it captured, and nothing else
+// of the scopes it was created in
 struct Function : public Object
 {
-    const std::string name;
-    const std::vector<std::string> params;
-    const std::vector<std::shared_ptr<Stmt>> body;
-    const std::shared_ptr<Environment> closure;
-
-    Function(std::string name, std::vector<std::string> params, 
-             std::vector<std::shared_ptr<Stmt>> body, 
-             std::shared_ptr<Environment> closure)
-        : name(name), params(params), body(body), closure(closure) {}
+    const FunctionPrototype* const prototype;
+    std::vector<UpvalueRef> upvalues;
+    bool marked = false;  // reached during the current collection
+
+    // Captures prototype->upvalues from scope, the scope the closure is
+    // created in, and from enclosing, the function running there (nullptr
+    // at the top level)
+    Function(const FunctionPrototype* prototype, Environment* scope, const Function* enclosing);
+    ~Function() override;
+
+    Value& upvalue(int index) const { return upvalues[index]->value(); }
+
+    // Storage of upvalue index, or of its fallbacks while it is undeclared;
+    // nullptr when the name stands for a global
+    Value* binding(int index) const {
+        for (;;) {
+            Value& value = upvalue(index);
+            if (!value.isUndeclared()) return &value;
+            index = prototype->upvalues[index].fallback;
+            if (index < 0) return nullptr;
+        }
+    }
+};
+
+// Arguments of a builtin call: a view of the caller's value stack, valid
+// until the builtin returns
+struct Arguments
+{
+    const Value* values;
+    size_t count;
+
+    size_t size() const { return count; }
+    const Value& operator[](size_t index) const { return values[index]; }
 };
 
 struct BuiltinFunction : public Object
 {
     const std::string name;
-    const std::function<Value(std::vector<Value>, int, int)> func;
+    const std::function<Value(Arguments, int, int)> func;
     
-    BuiltinFunction(std::string name, std::function<Value(std::vector<Value>, int, int)> func)
+    BuiltinFunction(std::string name, std::function<Value(Arguments, int, int)> func)
         : name(name), func(func) {}
 };
 
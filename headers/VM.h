@@ -0,0 +1,72 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "Bytecode.h"
+#include "Environment.h"
+#include "TypeWrapper.h"
+#include "Value.h"
+
+class Interpreter;
+class ErrorReporter;
+class GarbageCollector;
+class Profiler;
+
+// Maximum depth of nested calls before the VM reports a stack overflow
+constexpr size_t VM_FRAMES_MAX = 100000;
+
+// Stack-based virtual machine that runs chunks produced by the Compiler.
+// It shares globals, builtins and value semantics with the Interpreter that owns it.
+class VM {
+public:
+    explicit VM(Interpreter& interpreter) : interpreter(interpreter), errorReporter(nullptr) {}
+
+    void setErrorReporter(ErrorReporter* reporter) { errorReporter = reporter; }
+    void setProfiler(Profiler* newProfiler) { profiler = newProfiler; }
+
+    void run(const std::shared_ptr<Chunk>& script, const EnvironmentRef& globalScope);
+
+    // Report the values on the stack and the functions of active frames.
+    // Frame environments are found by the collector on its own.
+    void markRoots(GarbageCollector& collector);
+
+private:
+    struct CallFrame {
+        Function* function;  // nullptr for the top-level script
+        Chunk* chunk;
+        uint8_t* ip;
+        EnvironmentRef previousEnv;
+        size_t stackBase;  // the callee; a frame kept on the stack has its slots right after it
+    };
+
+    Interpreter& interpreter;
+    ErrorReporter* errorReporter;
+    Profiler* profiler = nullptr;
+    std::vector<Value> stack;
+    std::vector<CallFrame> frames;
+    EnvironmentRef environment;
+    EnvironmentRef globals;
+
+    void execute();
+    void callValue(const Value& callee, int argCount, const Token& paren, CallFrame*& frame);
+    void tailCall(Function* function, int argCount, CallFrame* frame);
+    void checkCall(Function* function, int argCount);
+
+    inline void push(const Value& value) { stack.push_back(value); }
+    inline void push(Value&& value) { stack.push_back(std::move(value)); }
+    inline Value pop() {
+        Value value = std::move(stack.back());
+        stack.pop_back();
+        return value;
+    }
+    inline Value& peek(size_t distance = 0) { return stack[stack.size() - 1 - distance]; }
+
+    // A variable addressed by a (depth, slot) operand pair; nullptr for a
+    // global, including an upvalue whose variable is not declared yet
+    inline Value* variable(const CallFrame* frame, uint16_t depth, uint16_t slot) {
+        if (depth == GLOBAL_DEPTH) return nullptr;
+        if (depth == UPVALUE_DEPTH) return frame->function->binding(slot);
+        if (depth == STACK_DEPTH) return &stack[frame->stackBase + 1 + slot];
+        return &environment->at(depth, slot);
+    }
+};
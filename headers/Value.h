@@ -6,266 +6,394 @@
 #include <cmath>
 #include <stdexcept>
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string_view>
 
 // Forward declarations
 class Environment;
 class Function;
 class BuiltinFunction;
 
-// Type tags for the Value union
-enum ValueType : uint8_t {
-    VAL_NONE,
-    VAL_NUMBER,
-    VAL_BOOLEAN,
-    VAL_STRING,
-    VAL_FUNCTION,
-    VAL_BUILTIN_FUNCTION
+// Heap payload for integers outside the 48 bits a NaN-boxed Value holds
+// inline. Immutable and reference counted like StringObject. Wide integer
+// arithmetic (hashing, 64-bit masks) creates and drops one per operation,
+// so freed objects are kept on a free list for reuse.
+struct IntegerObject {
+    static constexpr size_t POOL_LIMIT = 64;
+
+    uint32_t refCount;
+    int64_t value;
+
+    static IntegerObject* create(int64_t value) {
+        if (pooled == 0) return new IntegerObject{1, value};
+        IntegerObject* integer = pool[--pooled];
+        integer->refCount = 1;
+        integer->value = value;
+        return integer;
+    }
+
+    static void destroy(IntegerObject* integer) {
+        if (pooled < POOL_LIMIT) {
+            pool[pooled++] = integer;
+        } else {
+            delete integer;
+        }
+    }
+
+private:
+    // A plain array has no destructor, so values released during static
+    // destruction can still be pooled
+    static inline IntegerObject* pool[POOL_LIMIT];
+    static inline size_t pooled = 0;
 };
 
-// Tagged value system (like Lua) - no heap allocation for simple values
+// Heap payload for string values. Values share it through an intrusive,
+// non-atomic reference count; the interpreter is single threaded. It is
+// immutable while shared: only `+=` on the one Value holding a non-interned
+// string appends to it in place. The hash is computed on first use and kept. Literals
+// and strings of up to INTERN_MAX_LENGTH bytes are interned, so there is at
+// most one interned object per content and two interned strings are equal
+// exactly when they are the same object.
+//
+// Concatenations longer than ROPE_MIN_LENGTH produce a rope node that only
+// references its two halves; text() flattens it on first use and lets the
+// halves go. Building a string piece by piece is then linear instead of
+// copying the whole prefix on every step.
+struct StringObject {
+    static constexpr size_t INTERN_MAX_LENGTH = 16;
+    static constexpr size_t ROPE_MIN_LENGTH = 64;
+
+    uint32_t refCount;
+    bool interned = false;
+    mutable bool hashed = false;
+    mutable size_t hashValue = 0;
+
+    size_t length() const { return size; }
+
+    const std::string& text() const {
+        if (left) flatten();
+        return flat;
+    }
+
+    size_t hash() const {
+        if (!hashed) {
+            hashValue = std::hash<std::string_view>{}(text());
+            hashed = true;
+        }
+        return hashValue;
+    }
+
+    // Whether append() may change this string under its only holder
+    bool appendable() const { return refCount == 1 && !interned; }
+
+    void append(std::string_view piece) {
+        text();
+        flat.append(piece);
+        size = flat.size();
+        hashed = false;
+    }
+
+    static bool equal(const StringObject* a, const StringObject* b) {
+        if (a == b) return true;
+        if (a->interned && b->interned) return false;
+        if (a->length() != b->length()) return false;
+        if (a->hash() != b->hash()) return false;  // cached, so repeated compares stay cheap
+        return a->text() == b->text();
+    }
+
+    // All three return the object with one reference already taken for the caller
+    static StringObject* create(std::string str);  // interns short strings
+    static StringObject* intern(std::string str);
+    static StringObject* concat(StringObject* a, StringObject* b);
+    static void destroy(StringObject* string);     // also drops it from the intern table
+
+private:
+    size_t size;
+    mutable std::string flat;                  // empty while this is an unflattened rope
+    mutable StringObject* left = nullptr;      // rope halves, each holding a reference
+    mutable StringObject* right = nullptr;
+
+    explicit StringObject(std::string str) : refCount(1), size(str.size()), flat(std::move(str)) {}
+    StringObject(StringObject* a, StringObject* b) : refCount(1), size(a->size + b->size), left(a), right(b) {}
+
+    void flatten() const;
+
+};
+
+// NaN-boxed value: 8 bytes. A double is stored as itself; every other type
+// lives in the payload of a quiet NaN that real arithmetic never produces
+// (NaN results are canonicalized on construction). The top 16 bits tag the
+// type and the low 48 bits hold a pointer or a singleton id. Integers are
+// a separate number type: one that fits in 48 bits is stored in the payload,
+// a larger one is boxed in an IntegerObject. The negative quiet NaN tags hold
+// them, and the boxed tag differs from TAG_STRING only in the sign bit, so a
+// single compare finds the reference-counted payloads.
 struct Value {
-    union {
-        double number;
-        bool boolean;
-        Function* function;
-        BuiltinFunction* builtin_function;
-    };
-    ValueType type;
-    std::string string_value; // Store strings outside the union for safety
+    uint64_t bits;
+
+    static constexpr uint64_t QNAN          = 0x7ffc000000000000ULL;
+    static constexpr uint64_t TAG_MASK      = 0xffff000000000000ULL;
+    static constexpr uint64_t PAYLOAD_MASK  = 0x0000ffffffffffffULL;
+    static constexpr uint64_t TAG_SPECIAL   = 0x7ffc000000000000ULL;
+    static constexpr uint64_t TAG_STRING    = 0x7ffd000000000000ULL;
+    static constexpr uint64_t TAG_FUNCTION  = 0x7ffe000000000000ULL;
+    static constexpr uint64_t TAG_BUILTIN   = 0x7fff000000000000ULL;
+    static constexpr uint64_t TAG_INTEGER   = 0xfffc000000000000ULL;  // inline int48
+    static constexpr uint64_t TAG_BOXED_INTEGER = 0xfffd000000000000ULL;
+    static constexpr uint64_t INTEGER_MASK  = 0xfffe000000000000ULL;  // matches both integer tags
+    static constexpr uint64_t REFCOUNTED_MASK = 0x7fff000000000000ULL; // string or boxed integer
+    static constexpr uint64_t NONE_BITS     = TAG_SPECIAL | 1;
+    static constexpr uint64_t FALSE_BITS    = TAG_SPECIAL | 2;
+    static constexpr uint64_t TRUE_BITS     = TAG_SPECIAL | 3;
+    static constexpr uint64_t UNDECLARED_BITS = TAG_SPECIAL | 4;  // a scope slot before its declaration runs
+    static constexpr uint64_t CANONICAL_NAN = 0x7ff8000000000000ULL;
+    static constexpr int64_t INLINE_INTEGER_MIN = -(int64_t(1) << 47);
+    static constexpr int64_t INLINE_INTEGER_MAX = (int64_t(1) << 47) - 1;
 
     // Constructors
-    Value() : number(0.0), type(ValueType::VAL_NONE) {}
-    Value(double n) : number(n), type(ValueType::VAL_NUMBER) {}
-    Value(bool b) : boolean(b), type(ValueType::VAL_BOOLEAN) {}
-    Value(const char* s) : type(ValueType::VAL_STRING), string_value(s ? s : "") {}
-    Value(const std::string& s) : type(ValueType::VAL_STRING), string_value(s) {}
-    Value(std::string&& s) : type(ValueType::VAL_STRING), string_value(std::move(s)) {}
-    Value(Function* f) : function(f), type(ValueType::VAL_FUNCTION) {}
-    Value(BuiltinFunction* bf) : builtin_function(bf), type(ValueType::VAL_BUILTIN_FUNCTION) {}
-
-    // Move constructor
-    Value(Value&& other) noexcept 
-        : type(other.type), string_value(std::move(other.string_value)) {
-        if (type != ValueType::VAL_STRING) {
-            number = other.number; // Copy the union
+    Value() : bits(NONE_BITS) {}
+    Value(double n) {
+        if (n != n) {
+            bits = CANONICAL_NAN;
+        } else {
+            std::memcpy(&bits, &n, sizeof(double));
+        }
+    }
+    Value(bool b) : bits(b ? TRUE_BITS : FALSE_BITS) {}
+    Value(const char* s) : Value(std::string(s ? s : "")) {}
+    Value(const std::string& s) : Value(std::string(s)) {}
+    Value(std::string&& s) : bits(TAG_STRING | reinterpret_cast<uintptr_t>(StringObject::create(std::move(s)))) {}
+    Value(Function* f) : bits(TAG_FUNCTION | reinterpret_cast<uintptr_t>(f)) {}
+    Value(BuiltinFunction* bf) : bits(TAG_BUILTIN | reinterpret_cast<uintptr_t>(bf)) {}
+
+    // A named factory rather than a constructor, so int arguments elsewhere
+    // do not become ambiguous between double, bool and int64_t
+    static Value integer(int64_t n) {
+        Value value;
+        if (n >= INLINE_INTEGER_MIN && n <= INLINE_INTEGER_MAX) {
+            value.bits = TAG_INTEGER | (static_cast<uint64_t>(n) & PAYLOAD_MASK);
+        } else {
+            value.bits = TAG_BOXED_INTEGER | reinterpret_cast<uintptr_t>(IntegerObject::create(n));
         }
-        other.type = ValueType::VAL_NONE;
+        return value;
+    }
+
+    // Fills scope slots until their declaration runs; never seen by scripts
+    static Value undeclared() {
+        Value value;
+        value.bits = UNDECLARED_BITS;
+        return value;
+    }
+
+    // String literals are interned whatever their length
+    static Value intern(std::string s) {
+        Value value;
+        value.bits = TAG_STRING | reinterpret_cast<uintptr_t>(StringObject::intern(std::move(s)));
+        return value;
+    }
+
+    // Both must be strings; long results are ropes flattened on first use
+    static Value concat(const Value& a, const Value& b) {
+        Value value;
+        value.bits = TAG_STRING | reinterpret_cast<uintptr_t>(StringObject::concat(a.asStringObject(), b.asStringObject()));
+        return value;
+    }
+
+    Value(Value&& other) noexcept : bits(other.bits) {
+        other.bits = NONE_BITS;
     }
 
-    // Move assignment
     Value& operator=(Value&& other) noexcept {
         if (this != &other) {
-            type = other.type;
-            if (type == ValueType::VAL_STRING) {
-                string_value = std::move(other.string_value);
-            } else {
-                number = other.number; // Copy the union
-            }
-            other.type = ValueType::VAL_NONE;
+            release();
+            bits = other.bits;
+            other.bits = NONE_BITS;
         }
         return *this;
     }
 
-    // Copy constructor (only when needed)
-    Value(const Value& other) : type(other.type) {
-        if (type == ValueType::VAL_STRING) {
-            string_value = other.string_value;
-        } else {
-            number = other.number; // Copy the union
-        }
+    // Copies only touch memory for strings and boxed integers, to bump the
+    // reference count
+    Value(const Value& other) : bits(other.bits) {
+        retain();
     }
 
-    // Copy assignment (only when needed)
     Value& operator=(const Value& other) {
-        if (this != &other) {
-            type = other.type;
-            if (type == ValueType::VAL_STRING) {
-                string_value = other.string_value;
-            } else {
-                number = other.number; // Copy the union
-            }
-        }
+        other.retain();
+        release();
+        bits = other.bits;
         return *this;
     }
 
+    ~Value() { release(); }
+
+    // `+=` on a string held only by this Value: appends other, formatted the
+    // way operator+ does, to the existing buffer. Returns false when a new
+    // string has to be built instead.
+    bool appendInPlace(const Value& other) {
+        if (!isString() || !asStringObject()->appendable()) return false;
+        if (other.isString()) {
+            asStringObject()->append(other.asString());
+        } else {
+            asStringObject()->append(other.toString());
+        }
+        return true;
+    }
+
     // Type checking (fast, no dynamic casting) - inline for performance
-    inline bool isNumber() const { return type == ValueType::VAL_NUMBER; }
-    inline bool isBoolean() const { return type == ValueType::VAL_BOOLEAN; }
-    inline bool isString() const { return type == ValueType::VAL_STRING; }
-    inline bool isFunction() const { return type == ValueType::VAL_FUNCTION; }
-    inline bool isBuiltinFunction() const { return type == ValueType::VAL_BUILTIN_FUNCTION; }
-    inline bool isNone() const { return type == ValueType::VAL_NONE; }
+    inline bool isNumber() const { return isDouble() || isInteger(); }
+    inline bool isDouble() const { return (bits & QNAN) != QNAN; }
+    inline bool isInteger() const { return (bits & INTEGER_MASK) == TAG_INTEGER; }
+    inline bool isInlineInteger() const { return (bits & TAG_MASK) == TAG_INTEGER; }
+    inline bool isBoolean() const { return bits == TRUE_BITS || bits == FALSE_BITS; }
+    inline bool isString() const { return (bits & TAG_MASK) == TAG_STRING; }
+    inline bool isFunction() const { return (bits & TAG_MASK) == TAG_FUNCTION; }
+    inline bool isBuiltinFunction() const { return (bits & TAG_MASK) == TAG_BUILTIN; }
+    inline bool isNone() const { return bits == NONE_BITS; }
+    inline bool isUndeclared() const { return bits == UNDECLARED_BITS; }
 
     // Value extraction (safe, with type checking) - inline for performance
-    inline double asNumber() const { return isNumber() ? number : 0.0; }
-    inline bool asBoolean() const { return isBoolean() ? boolean : false; }
-    inline const std::string& asString() const { return string_value; }
-    inline Function* asFunction() const { return isFunction() ? function : nullptr; }
-    inline BuiltinFunction* asBuiltinFunction() const { return isBuiltinFunction() ? builtin_function : nullptr; }
+    // Any number as a double
+    inline double asNumber() const {
+        if (isDouble()) {
+            double n;
+            std::memcpy(&n, &bits, sizeof(double));
+            return n;
+        }
+        return isInteger() ? static_cast<double>(asInteger()) : 0.0;
+    }
+    inline int64_t asInteger() const {
+        if (isInlineInteger()) return static_cast<int64_t>(bits << 16) >> 16;
+        if ((bits & TAG_MASK) == TAG_BOXED_INTEGER) return asIntegerObject()->value;
+        return 0;
+    }
+    inline bool asBoolean() const { return bits == TRUE_BITS; }
+    inline const std::string& asString() const {
+        static const std::string empty;
+        return isString() ? asStringObject()->text() : empty;
+    }
+    inline Function* asFunction() const { return isFunction() ? reinterpret_cast<Function*>(bits & PAYLOAD_MASK) : nullptr; }
+    inline BuiltinFunction* asBuiltinFunction() const { return isBuiltinFunction() ? reinterpret_cast<BuiltinFunction*>(bits & PAYLOAD_MASK) : nullptr; }
 
     // Truthiness check - inline for performance
     inline bool isTruthy() const {
-        switch (type) {
-            case ValueType::VAL_NONE: return false;
-            case ValueType::VAL_BOOLEAN: return boolean;
-            case ValueType::VAL_NUMBER: return number != 0.0;
-            case ValueType::VAL_STRING: return !string_value.empty();
-            case ValueType::VAL_FUNCTION: return function != nullptr;
-            case ValueType::VAL_BUILTIN_FUNCTION: return builtin_function != nullptr;
-            default: return false;
+        if (isDouble()) return asNumber() != 0.0;
+        if (isInteger()) return asInteger() != 0;
+        if (isString()) return asStringObject()->length() != 0;
+        if (isFunction() || isBuiltinFunction()) return (bits & PAYLOAD_MASK) != 0;
+        return bits == TRUE_BITS;
+    }
+
+    // Orders two numbers: -1, 0 or 1, or UNORDERED when either is NaN. An
+    // integer and a double are compared exactly; the integer is not rounded.
+    static constexpr int UNORDERED = 2;
+    static int compareNumbers(const Value& left, const Value& right) {
+        if (left.isInteger() && right.isInteger()) {
+            int64_t a = left.asInteger();
+            int64_t b = right.asInteger();
+            return (a > b) - (a < b);
+        }
+        if (left.isDouble() && right.isDouble()) {
+            double a = left.asNumber();
+            double b = right.asNumber();
+            if (a < b) return -1;
+            if (a > b) return 1;
+            return a == b ? 0 : UNORDERED;
         }
+        if (left.isDouble()) {
+            int order = compareNumbers(right, left);
+            return order == UNORDERED ? order : -order;
+        }
+        int64_t a = left.asInteger();
+        double b = right.asNumber();
+        if (std::isnan(b)) return UNORDERED;
+        if (b >= 9223372036854775808.0) return -1;
+        if (b < -9223372036854775808.0) return 1;
+        double whole = std::trunc(b);
+        int64_t c = static_cast<int64_t>(whole);
+        if (a != c) return a < c ? -1 : 1;
+        if (b > whole) return -1;
+        return b < whole ? 1 : 0;
     }
 
     // Equality comparison - inline for performance
     inline bool equals(const Value& other) const {
-        if (type != other.type) return false;
-        
-        switch (type) {
-            case ValueType::VAL_NONE: return true;
-            case ValueType::VAL_BOOLEAN: return boolean == other.boolean;
-            case ValueType::VAL_NUMBER: return number == other.number;
-            case ValueType::VAL_STRING: return string_value == other.string_value;
-            case ValueType::VAL_FUNCTION: return function == other.function;
-            case ValueType::VAL_BUILTIN_FUNCTION: return builtin_function == other.builtin_function;
-            default: return false;
-        }
+        if (isInteger() && other.isInteger()) return asInteger() == other.asInteger();
+        if (isNumber() && other.isNumber()) return compareNumbers(*this, other) == 0;
+        if (isString() && other.isString()) return StringObject::equal(asStringObject(), other.asStringObject());
+        return bits == other.bits;
     }
 
     // String representation
     std::string toString() const {
-        switch (type) {
-            case ValueType::VAL_NONE: return "none";
-            case ValueType::VAL_BOOLEAN: return boolean ? "true" : "false";
-            case ValueType::VAL_NUMBER: {
-                // Format numbers like the original stringify function
-                if (number == std::floor(number)) {
-                    return std::to_string(static_cast<long long>(number));
-                } else {
-                    std::string str = std::to_string(number);
-                    // Remove trailing zeros
-                    str.erase(str.find_last_not_of('0') + 1, std::string::npos);
-                    if (str.back() == '.') str.pop_back();
-                    return str;
-                }
+        if (isInteger()) return std::to_string(asInteger());
+        if (isDouble()) {
+            double number = asNumber();
+            // Format numbers like the original stringify function
+            if (number == std::floor(number)) {
+                return std::to_string(static_cast<long long>(number));
+            } else {
+                std::string str = std::to_string(number);
+                // Remove trailing zeros
+                str.erase(str.find_last_not_of('0') + 1, std::string::npos);
+                if (str.back() == '.') str.pop_back();
+                return str;
             }
-            case ValueType::VAL_STRING: return string_value;
-            case ValueType::VAL_FUNCTION: return "<function>";
-            case ValueType::VAL_BUILTIN_FUNCTION: return "<builtin_function>";
-            default: return "unknown";
         }
+        if (isString()) return asString();
+        if (isFunction()) return "<function>";
+        if (isBuiltinFunction()) return "<builtin_function>";
+        if (isBoolean()) return asBoolean() ? "true" : "false";
+        return "none";
     }
 
-    // Arithmetic operators
+    // Concatenation; at least one operand must be a string. Numeric
+    // operators are evaluated by numberBinary (Numeric.h).
     Value operator+(const Value& other) const {
-        if (isNumber() && other.isNumber()) {
-            return Value(number + other.number);
-        }
         if (isString() && other.isString()) {
-            return Value(string_value + other.string_value);
-        }
-        if (isString() && other.isNumber()) {
-            return Value(string_value + other.toString());
-        }
-        if (isNumber() && other.isString()) {
-            return Value(toString() + other.string_value);
-        }
-        // Handle none values by converting to string
-        if (isString() && other.isNone()) {
-            return Value(string_value + "none");
-        }
-        if (isNone() && other.isString()) {
-            return Value("none" + other.string_value);
-        }
-        if (isString() && !other.isString() && !other.isNumber()) {
-            return Value(string_value + other.toString());
-        }
-        if (!isString() && !isNumber() && other.isString()) {
-            return Value(toString() + other.string_value);
-        }
-        throw std::runtime_error("Invalid operands for + operator");
-    }
-
-    Value operator-(const Value& other) const {
-        if (isNumber() && other.isNumber()) {
-            return Value(number - other.number);
-        }
-        throw std::runtime_error("Invalid operands for - operator");
-    }
-
-    Value operator*(const Value& other) const {
-        if (isNumber() && other.isNumber()) {
-            return Value(number * other.number);
-        }
-        if (isString() && other.isNumber()) {
-            std::string result;
-            for (int i = 0; i < static_cast<int>(other.number); ++i) {
-                result += string_value;
-            }
-            return Value(result);
-        }
-        if (isNumber() && other.isString()) {
-            std::string result;
-            for (int i = 0; i < static_cast<int>(number); ++i) {
-                result += other.string_value;
-            }
-            return Value(result);
+            return concat(*this, other);
         }
-        throw std::runtime_error("Invalid operands for * operator");
-    }
-
-    Value operator/(const Value& other) const {
-        if (isNumber() && other.isNumber()) {
-            if (other.number == 0) {
-                throw std::runtime_error("Division by zero");
+        // Anything added to a string is formatted the way toString does
+        if (isString() || other.isString()) {
+            std::string formatted = isString() ? other.toString() : toString();
+            const Value& string = isString() ? *this : other;
+            if (string.asStringObject()->length() + formatted.size() <= StringObject::ROPE_MIN_LENGTH) {
+                return Value(isString() ? string.asString() + formatted : formatted + string.asString());
             }
-            return Value(number / other.number);
-        }
-        throw std::runtime_error("Invalid operands for / operator");
-    }
-
-    Value operator%(const Value& other) const {
-        if (isNumber() && other.isNumber()) {
-            return Value(fmod(number, other.number));
-        }
-        throw std::runtime_error("Invalid operands for % operator");
-    }
-
-    Value operator&(const Value& other) const {
-        if (isNumber() && other.isNumber()) {
-            return Value(static_cast<double>(static_cast<long>(number) & static_cast<long>(other.number)));
+            return isString() ? concat(*this, Value(std::move(formatted))) : concat(Value(std::move(formatted)), other);
         }
-        throw std::runtime_error("Invalid operands for & operator");
+        throw std::runtime_error("Invalid operands for + operator");
     }
 
-    Value operator|(const Value& other) const {
-        if (isNumber() && other.isNumber()) {
-            return Value(static_cast<double>(static_cast<long>(number) | static_cast<long>(other.number)));
-        }
-        throw std::runtime_error("Invalid operands for | operator");
-    }
+private:
+    inline StringObject* asStringObject() const { return reinterpret_cast<StringObject*>(bits & PAYLOAD_MASK); }
+    inline IntegerObject* asIntegerObject() const { return reinterpret_cast<IntegerObject*>(bits & PAYLOAD_MASK); }
 
-    Value operator^(const Value& other) const {
-        if (isNumber() && other.isNumber()) {
-            return Value(static_cast<double>(static_cast<long>(number) ^ static_cast<long>(other.number)));
-        }
-        throw std::runtime_error("Invalid operands for ^ operator");
-    }
+    inline bool isRefCounted() const { return (bits & REFCOUNTED_MASK) == TAG_STRING; }
 
-    Value operator<<(const Value& other) const {
-        if (isNumber() && other.isNumber()) {
-            return Value(static_cast<double>(static_cast<long>(number) << static_cast<long>(other.number)));
+    inline void retain() const {
+        if (!isRefCounted()) return;
+        if (isString()) {
+            asStringObject()->refCount++;
+        } else {
+            asIntegerObject()->refCount++;
         }
-        throw std::runtime_error("Invalid operands for << operator");
     }
 
-    Value operator>>(const Value& other) const {
-        if (isNumber() && other.isNumber()) {
-            return Value(static_cast<double>(static_cast<long>(number) >> static_cast<long>(other.number)));
+    inline void release() {
+        if (!isRefCounted()) return;
+        if (isString()) {
+            if (--asStringObject()->refCount == 0) StringObject::destroy(asStringObject());
+        } else if (--asIntegerObject()->refCount == 0) {
+            IntegerObject::destroy(asIntegerObject());
         }
-        throw std::runtime_error("Invalid operands for >> operator");
     }
 };
 
+static_assert(sizeof(Value) == 8, "Value must stay NaN-boxed in 8 bytes");
+
 // Global constants for common values
 extern const Value NONE_VALUE;
 extern const Value TRUE_VALUE;
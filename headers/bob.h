@@ -4,9 +4,11 @@
 #include <fstream>
 #include <string>
 #include "../headers/Lexer.h"
+#include "../headers/AstArena.h"
 #include "../headers/Interpreter.h"
 #include "../headers/helperFunctions/ShortHands.h"
 #include "../headers/ErrorReporter.h"
+#include "../headers/Profiler.h"
 
 #define VERSION "0.0.1"
 
@@ -14,8 +16,13 @@ class Bob
 {
 public:
     Lexer lexer;
+    AstArena arena;  // owns every parsed AST; outlives the interpreter's functions
     sptr(Interpreter) interpreter;
     ErrorReporter errorReporter;
+    bool useBytecode = true;  // false runs the tree-walking interpreter (--tree-walker)
+    bool gcStats = false;     // print collector statistics on exit (--gc-stats)
+    bool profile = false;     // per-function profile on exit (--profile[=FILE])
+    std::string profileOutput = "bob.folded";  // collapsed stacks for flamegraph.pl
 
     ~Bob() = default;
 
@@ -24,6 +31,10 @@ public:
     void runPrompt();
 
 private:
+    std::unique_ptr<Profiler> profiler;
+
     void run(std::string source);
+    void startProfiler();
+    void finishRun();
 };
 
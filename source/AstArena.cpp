@@ -0,0 +1,24 @@
+#include "../headers/AstArena.h"
+#include <cstdint>
+
+AstArena::~AstArena() {
+    for (auto it = destructors.rbegin(); it != destructors.rend(); ++it) {
+        it->destroy(it->object);
+    }
+}
+
+void* AstArena::allocate(size_t size, size_t alignment) {
+    size_t padding = (alignment - reinterpret_cast<uintptr_t>(cursor) % alignment) % alignment;
+    if (cursor == nullptr || padding + size > remaining) {
+        size_t blockSize = size + alignment > BLOCK_SIZE ? size + alignment : BLOCK_SIZE;
+        blocks.push_back(std::make_unique<char[]>(blockSize));
+        cursor = blocks.back().get();
+        remaining = blockSize;
+        padding = (alignment - reinterpret_cast<uintptr_t>(cursor) % alignment) % alignment;
+    }
+
+    char* memory = cursor + padding;
+    cursor = memory + size;
+    remaining -= padding + size;
+    return memory;
+}
@@ -0,0 +1,254 @@
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include "../headers/BinaryDispatch.h"
+#include "../headers/ErrorReporter.h"
+#include "../headers/Numeric.h"
+
+namespace {
+
+// Which rules apply to a pair of operand types
+enum class OperandPair {
+    Integers,
+    Numbers,       // at least one double
+    Strings,
+    StringNumber,
+    NumberString,
+    Booleans,
+    StringBoolean, // either order
+    StringNone,
+    NoneString,
+    Mismatched
+};
+
+constexpr bool isNumberKind(ValueKind kind) {
+    return kind == ValueKind::Integer || kind == ValueKind::Double;
+}
+
+constexpr OperandPair pairOf(ValueKind left, ValueKind right) {
+    if (left == ValueKind::Integer && right == ValueKind::Integer) return OperandPair::Integers;
+    if (isNumberKind(left) && isNumberKind(right)) return OperandPair::Numbers;
+    if (left == ValueKind::String && right == ValueKind::String) return OperandPair::Strings;
+    if (left == ValueKind::String && isNumberKind(right)) return OperandPair::StringNumber;
+    if (isNumberKind(left) && right == ValueKind::String) return OperandPair::NumberString;
+    if (left == ValueKind::Boolean && right == ValueKind::Boolean) return OperandPair::Booleans;
+    if ((left == ValueKind::String && right == ValueKind::Boolean) ||
+        (left == ValueKind::Boolean && right == ValueKind::String)) return OperandPair::StringBoolean;
+    if (left == ValueKind::String && right == ValueKind::None) return OperandPair::StringNone;
+    if (left == ValueKind::None && right == ValueKind::String) return OperandPair::NoneString;
+    return OperandPair::Mismatched;
+}
+
+// The token numberBinary and integerBinary switch on
+constexpr TokenType tokenFor(BinaryOp op) {
+    switch (op) {
+        case BinaryOp::Add: return PLUS;
+        case BinaryOp::Subtract: return MINUS;
+        case BinaryOp::Multiply: return STAR;
+        case BinaryOp::Divide: return SLASH;
+        case BinaryOp::Modulo: return PERCENT;
+        case BinaryOp::Greater: return GREATER;
+        case BinaryOp::GreaterEqual: return GREATER_EQUAL;
+        case BinaryOp::Less: return LESS;
+        case BinaryOp::LessEqual: return LESS_EQUAL;
+        case BinaryOp::Equal: return DOUBLE_EQUAL;
+        case BinaryOp::NotEqual: return BANG_EQUAL;
+        case BinaryOp::BitAnd: return BIN_AND;
+        case BinaryOp::BitOr: return BIN_OR;
+        case BinaryOp::BitXor: return BIN_XOR;
+        case BinaryOp::ShiftLeft: return BIN_SLEFT;
+        case BinaryOp::ShiftRight: return BIN_SRIGHT;
+        default: return END_OF_FILE;
+    }
+}
+
+[[noreturn]] void fail(const Token& oper, ErrorReporter* errors, const std::string& errorType,
+                       const std::string& message, const std::string& thrown) {
+    if (errors) {
+        errors->reportError(oper.line, oper.column, errorType, message, std::string(oper.lexeme));
+    }
+    throw std::runtime_error(thrown);
+}
+
+[[noreturn]] void failRuntime(const Token& oper, ErrorReporter* errors, const std::string& message) {
+    fail(oper, errors, "Runtime Error", message, message);
+}
+
+[[noreturn]] void failMismatched(const Token& oper, ErrorReporter* errors) {
+    failRuntime(oper, errors, "Operands must be of same type when using: " + std::string(oper.lexeme));
+}
+
+Value checkNumeric(NumericResult status, Value result, const Token& oper, ErrorReporter* errors) {
+    switch (status) {
+        case NumericResult::Ok:
+            return result;
+        case NumericResult::DivideByZero:
+            fail(oper, errors, "Division by Zero", "Cannot divide by zero", "Division by zero");
+        case NumericResult::ModuloByZero:
+            fail(oper, errors, "Modulo by Zero", "Cannot perform modulo operation with zero", "Modulo by zero");
+        case NumericResult::NotAnInteger:
+            failRuntime(oper, errors, "Bitwise operands must fit in a 64-bit integer");
+        case NumericResult::BadShiftCount:
+            failRuntime(oper, errors, "Shift count must be between 0 and 63");
+        case NumericResult::NotNumeric:
+            break;
+    }
+    failMismatched(oper, errors);
+}
+
+bool isWholeNumber(double number) {
+    double integral;
+    double fractional = std::modf(number, &integral);
+    return std::abs(fractional) < std::numeric_limits<double>::epsilon();
+}
+
+Value repeat(const Value& text, const Value& count, const Token& oper, ErrorReporter* errors) {
+    double times = count.asNumber();
+    if (!isWholeNumber(times)) {
+        fail(oper, errors, "Invalid String Multiplication", "String multiplier must be a whole number",
+             "String multiplier must be whole number");
+    }
+    std::string result;
+    for (int i = 0; i < static_cast<int>(times); i++) {
+        result += text.asString();
+    }
+    return Value(std::move(result));
+}
+
+// One rule per operand pair; Op is a constant, so each instantiation keeps
+// only its own branch. Unlisted pairs and operators are type errors.
+template<OperandPair Pair, BinaryOp Op>
+struct BinaryRule {
+    static Value apply(const Token& oper, const Value& left, const Value& right, ErrorReporter* errors) {
+        failMismatched(oper, errors);
+    }
+};
+
+template<BinaryOp Op>
+struct BinaryRule<OperandPair::Integers, Op> {
+    static Value apply(const Token& oper, const Value& left, const Value& right, ErrorReporter* errors) {
+        Value result;
+        NumericResult status = integerBinary(tokenFor(Op), left.asInteger(), right.asInteger(), result);
+        return checkNumeric(status, std::move(result), oper, errors);
+    }
+};
+
+template<BinaryOp Op>
+struct BinaryRule<OperandPair::Numbers, Op> {
+    static Value apply(const Token& oper, const Value& left, const Value& right, ErrorReporter* errors) {
+        Value result;
+        NumericResult status = numberBinary(tokenFor(Op), left, right, result);
+        return checkNumeric(status, std::move(result), oper, errors);
+    }
+};
+
+template<BinaryOp Op>
+struct BinaryRule<OperandPair::Strings, Op> {
+    static Value apply(const Token& oper, const Value& left, const Value& right, ErrorReporter* errors) {
+        if constexpr (Op == BinaryOp::Add) {
+            return Value::concat(left, right);
+        } else if constexpr (Op == BinaryOp::Equal) {
+            return Value(left.equals(right));
+        } else if constexpr (Op == BinaryOp::NotEqual) {
+            return Value(!left.equals(right));
+        } else {
+            std::string lexeme(oper.lexeme);
+            failRuntime(oper, errors, "Cannot use '" + lexeme + "' on two strings");
+        }
+    }
+};
+
+template<BinaryOp Op>
+struct BinaryRule<OperandPair::StringNumber, Op> {
+    static Value apply(const Token& oper, const Value& left, const Value& right, ErrorReporter* errors) {
+        if constexpr (Op == BinaryOp::Add) {
+            return left + right;
+        } else if constexpr (Op == BinaryOp::Multiply) {
+            return repeat(left, right, oper, errors);
+        } else {
+            failMismatched(oper, errors);
+        }
+    }
+};
+
+template<BinaryOp Op>
+struct BinaryRule<OperandPair::NumberString, Op> {
+    static Value apply(const Token& oper, const Value& left, const Value& right, ErrorReporter* errors) {
+        if constexpr (Op == BinaryOp::Add) {
+            return left + right;
+        } else if constexpr (Op == BinaryOp::Multiply) {
+            return repeat(right, left, oper, errors);
+        } else {
+            failMismatched(oper, errors);
+        }
+    }
+};
+
+template<BinaryOp Op>
+struct BinaryRule<OperandPair::Booleans, Op> {
+    static Value apply(const Token& oper, const Value& left, const Value& right, ErrorReporter* errors) {
+        if constexpr (Op == BinaryOp::Equal) {
+            return Value(left.asBoolean() == right.asBoolean());
+        } else if constexpr (Op == BinaryOp::NotEqual) {
+            return Value(left.asBoolean() != right.asBoolean());
+        } else {
+            failMismatched(oper, errors);
+        }
+    }
+};
+
+template<BinaryOp Op>
+struct BinaryRule<OperandPair::StringBoolean, Op> {
+    static Value apply(const Token& oper, const Value& left, const Value& right, ErrorReporter* errors) {
+        if constexpr (Op == BinaryOp::Add) {
+            return left + right;
+        } else {
+            failMismatched(oper, errors);
+        }
+    }
+};
+
+template<BinaryOp Op>
+struct BinaryRule<OperandPair::StringNone, Op> {
+    static Value apply(const Token& oper, const Value& left, const Value& right, ErrorReporter* errors) {
+        if constexpr (Op == BinaryOp::Add) {
+            return left + right;
+        } else {
+            std::string lexeme(oper.lexeme);
+            failRuntime(oper, errors, "Cannot use '" + lexeme + "' on a string and none");
+        }
+    }
+};
+
+template<BinaryOp Op>
+struct BinaryRule<OperandPair::NoneString, Op> {
+    static Value apply(const Token& oper, const Value& left, const Value& right, ErrorReporter* errors) {
+        if constexpr (Op == BinaryOp::Add) {
+            return left + right;
+        } else {
+            std::string lexeme(oper.lexeme);
+            failRuntime(oper, errors, "Cannot use '" + lexeme + "' on none and a string");
+        }
+    }
+};
+
+template<size_t Index>
+constexpr BinaryHandler handlerAt() {
+    constexpr auto left = static_cast<ValueKind>(Index / BINARY_OP_COUNT / KIND_COUNT);
+    constexpr auto right = static_cast<ValueKind>(Index / BINARY_OP_COUNT % KIND_COUNT);
+    constexpr auto op = static_cast<BinaryOp>(Index % BINARY_OP_COUNT);
+    static_assert(binaryHandlerIndex(left, right, op) == Index, "Handler index layout");
+    return &BinaryRule<pairOf(left, right), op>::apply;
+}
+
+template<size_t... Indices>
+constexpr std::array<BinaryHandler, sizeof...(Indices)> makeHandlers(std::index_sequence<Indices...>) {
+    return {handlerAt<Indices>()...};
+}
+
+} // namespace
+
+constexpr std::array<BinaryHandler, KIND_COUNT * KIND_COUNT * BINARY_OP_COUNT> BINARY_HANDLERS =
+    makeHandlers(std::make_index_sequence<KIND_COUNT * KIND_COUNT * BINARY_OP_COUNT>());
@@ -0,0 +1,347 @@
+#include "../headers/Compiler.h"
+#include <stdexcept>
+
+std::shared_ptr<Chunk> Compiler::compile(const std::vector<Stmt*>& statements) {
+    chunk = std::make_shared<Chunk>();
+    for (const auto& statement : statements) {
+        compileStatement(statement);
+    }
+    emit(OP_NONE);
+    emit(OP_RETURN);
+    return chunk;
+}
+
+void Compiler::compileStatement(Stmt* statement) {
+    visitStmt(*this, *statement, nullptr);
+}
+
+void Compiler::compileExpression(Expr* expression) {
+    visitExpr(*this, *expression);
+}
+
+uint32_t Compiler::addConstant(const Value& value) {
+    chunk->constants.push_back(value);
+    return static_cast<uint32_t>(chunk->constants.size() - 1);
+}
+
+uint32_t Compiler::addToken(const Token& token) {
+    chunk->tokens.push_back(token);
+    return static_cast<uint32_t>(chunk->tokens.size() - 1);
+}
+
+uint32_t Compiler::addGlobalCache() {
+    chunk->globalCaches.emplace_back();
+    return static_cast<uint32_t>(chunk->globalCaches.size() - 1);
+}
+
+size_t Compiler::emitJump(OpCode op) {
+    emit(op);
+    size_t operandOffset = chunk->code.size();
+    chunk->writeInt(0);
+    return operandOffset;
+}
+
+void Compiler::patchJump(size_t operandOffset) {
+    chunk->patchInt(operandOffset, static_cast<uint32_t>(chunk->code.size()));
+}
+
+// Compiles the body into the prototype's own chunk and returns the
+// prototype's index in the enclosing chunk
+uint32_t Compiler::compileFunction(FunctionPrototype& prototype) {
+    std::shared_ptr<Chunk> enclosing = chunk;
+    const FunctionPrototype* enclosingFunction = function;
+    chunk = std::make_shared<Chunk>();
+    function = &prototype;
+    for (const auto& statement : prototype.body) {
+        compileStatement(statement);
+    }
+    emit(OP_NONE);
+    emit(OP_RETURN);
+    prototype.chunk = chunk;
+    chunk = enclosing;
+    function = enclosingFunction;
+
+    chunk->functions.push_back(&prototype);
+    return static_cast<uint32_t>(chunk->functions.size() - 1);
+}
+
+// Operands addressing a variable: GLOBAL_DEPTH for globals, UPVALUE_DEPTH and
+// the index for upvalues, STACK_DEPTH and the slot for frames on the value
+// stack, otherwise (depth, slot)
+void Compiler::emitVariable(int depth, int slot, int upvalue) {
+    if (upvalue >= 0) {
+        emitShort(UPVALUE_DEPTH);
+        emitShort(static_cast<uint16_t>(upvalue));
+    } else if (depth < 0) {
+        emitShort(GLOBAL_DEPTH);
+        emitShort(0);
+    } else if (frameOnStack()) {
+        emitShort(STACK_DEPTH);
+        emitShort(static_cast<uint16_t>(slot));
+    } else {
+        emitShort(static_cast<uint16_t>(depth));
+        emitShort(static_cast<uint16_t>(slot));
+    }
+}
+
+// Whether an upvalue of the function being compiled may be undeclared when used
+bool Compiler::declaredLater(int upvalue) const {
+    return function->upvalues[upvalue].fallback != FunctionPrototype::NO_FALLBACK;
+}
+
+// Operands of OP_GET_LOCAL/OP_SET_LOCAL, or of the stack forms, which take only the slot
+void Compiler::emitLocal(int depth, int slot) {
+    if (!frameOnStack()) {
+        emitShort(static_cast<uint16_t>(depth));
+    }
+    emitShort(static_cast<uint16_t>(slot));
+}
+
+void Compiler::emitDefine(const Token& name, int slot) {
+    if (slot < 0) {
+        emit(OP_DEFINE_GLOBAL);
+        emitInt(addToken(name));
+    } else {
+        emit(frameOnStack() ? OP_DEFINE_STACK : OP_DEFINE_LOCAL);
+        emitShort(static_cast<uint16_t>(slot));
+    }
+}
+
+Value Compiler::visitLiteralExpr(LiteralExpr& expression) {
+    const Value& value = expression.value;
+    if (value.isNone()) {
+        emit(OP_NONE);
+    } else if (value.isBoolean()) {
+        emit(value.asBoolean() ? OP_TRUE : OP_FALSE);
+    } else {
+        emit(OP_CONSTANT);
+        emitInt(addConstant(value));
+    }
+    return NONE_VALUE;
+}
+
+Value Compiler::visitLogicalExpr(LogicalExpr& expression) {
+    compileExpression(expression.left);
+    size_t endJump = emitJump(expression.oper.type == OR ? OP_JUMP_IF_TRUE_OR_POP : OP_JUMP_IF_FALSE_OR_POP);
+    compileExpression(expression.right);
+    patchJump(endJump);
+    return NONE_VALUE;
+}
+
+// Emits a test that jumps when the condition's truthiness equals jumpWhen and
+// falls through otherwise, appending the jump operands to jumps. and/or and !
+// become control flow here instead of producing intermediate values.
+void Compiler::compileBranch(Expr* condition, bool jumpWhen, std::vector<size_t>& jumps) {
+    while (auto* grouping = nodeCast<GroupingExpr>(condition)) {
+        condition = grouping->expression;
+    }
+
+    if (auto* logical = nodeCast<LogicalExpr>(condition)) {
+        // `a and b` is false as soon as a is false; `a or b` is true as soon as a is true
+        if ((logical->oper.type == AND) != jumpWhen) {
+            compileBranch(logical->left, jumpWhen, jumps);
+            compileBranch(logical->right, jumpWhen, jumps);
+        } else {
+            std::vector<size_t> skipRight;
+            compileBranch(logical->left, !jumpWhen, skipRight);
+            compileBranch(logical->right, jumpWhen, jumps);
+            for (size_t jump : skipRight) {
+                patchJump(jump);
+            }
+        }
+        return;
+    }
+
+    auto* unary = nodeCast<UnaryExpr>(condition);
+    if (unary && unary->oper.type == BANG) {
+        compileBranch(unary->right, !jumpWhen, jumps);
+        return;
+    }
+
+    compileExpression(condition);
+    jumps.push_back(emitJump(jumpWhen ? OP_JUMP_IF_TRUE : OP_JUMP_IF_FALSE));
+}
+
+Value Compiler::visitGroupingExpr(GroupingExpr& expression) {
+    compileExpression(expression.expression);
+    return NONE_VALUE;
+}
+
+Value Compiler::visitUnaryExpr(UnaryExpr& expression) {
+    compileExpression(expression.right);
+    switch (expression.oper.type) {
+        case MINUS:
+            emit(OP_NEGATE);
+            emitInt(addToken(expression.oper));
+            break;
+        case BANG:
+            emit(OP_NOT);
+            break;
+        case BIN_NOT:
+            emit(OP_BIN_NOT);
+            emitInt(addToken(expression.oper));
+            break;
+        default:
+            throw std::runtime_error("Invalid unary expression");
+    }
+    return NONE_VALUE;
+}
+
+Value Compiler::visitBinaryExpr(BinaryExpr& expression) {
+    compileExpression(expression.left);
+    compileExpression(expression.right);
+    emit(OP_BINARY);
+    emitInt(addToken(expression.oper));
+    return NONE_VALUE;
+}
+
+Value Compiler::visitVarExpr(VarExpr& expression) {
+    if (expression.upvalue >= 0 && declaredLater(expression.upvalue)) {
+        emit(OP_GET_UPVALUE_OR_GLOBAL);
+        emitShort(static_cast<uint16_t>(expression.upvalue));
+        emitInt(addToken(expression.name));
+        emitInt(addGlobalCache());
+    } else if (expression.upvalue >= 0) {
+        emit(OP_GET_UPVALUE);
+        emitShort(static_cast<uint16_t>(expression.upvalue));
+    } else if (expression.depth < 0) {
+        emit(OP_GET_GLOBAL);
+        emitInt(addToken(expression.name));
+        emitInt(addGlobalCache());
+    } else {
+        emit(frameOnStack() ? OP_GET_STACK : OP_GET_LOCAL);
+        emitLocal(expression.depth, expression.slot);
+    }
+    return NONE_VALUE;
+}
+
+Value Compiler::visitIncrementExpr(IncrementExpr& expression) {
+    auto varExpr = nodeCast<VarExpr>(expression.operand);
+    if (!varExpr) {
+        throw std::runtime_error("Increment/decrement can only be applied to variables.");
+    }
+    emit(OP_INCREMENT);
+    emitInt(addToken(varExpr->name));
+    emitInt(addToken(expression.oper));
+    emit(expression.isPrefix ? 1 : 0);
+    emitVariable(expression.depth, expression.slot, expression.upvalue);
+    emitInt(addGlobalCache());
+    return NONE_VALUE;
+}
+
+Value Compiler::visitAssignExpr(AssignExpr& expression) {
+    compileExpression(expression.value);
+    if (expression.op.type != EQUAL) {
+        emit(OP_COMPOUND_ASSIGN);
+        emitInt(addToken(expression.name));
+        emitInt(addToken(expression.op));
+        emitVariable(expression.depth, expression.slot, expression.upvalue);
+        emitInt(addGlobalCache());
+    } else if (expression.upvalue >= 0 && declaredLater(expression.upvalue)) {
+        emit(OP_SET_UPVALUE_OR_GLOBAL);
+        emitShort(static_cast<uint16_t>(expression.upvalue));
+        emitInt(addToken(expression.name));
+        emitInt(addGlobalCache());
+    } else if (expression.upvalue >= 0) {
+        emit(OP_SET_UPVALUE);
+        emitShort(static_cast<uint16_t>(expression.upvalue));
+    } else if (expression.depth < 0) {
+        emit(OP_SET_GLOBAL);
+        emitInt(addToken(expression.name));
+        emitInt(addGlobalCache());
+    } else {
+        emit(frameOnStack() ? OP_SET_STACK : OP_SET_LOCAL);
+        emitLocal(expression.depth, expression.slot);
+    }
+    return NONE_VALUE;
+}
+
+void Compiler::emitCall(CallExpr& expression, OpCode op) {
+    if (expression.arguments.size() > UINT8_MAX) {
+        throw std::runtime_error("Cannot have more than 255 arguments.");
+    }
+    compileExpression(expression.callee);
+    for (const auto& argument : expression.arguments) {
+        compileExpression(argument);
+    }
+    emit(op);
+    emit(static_cast<uint8_t>(expression.arguments.size()));
+    emitInt(addToken(expression.paren));
+}
+
+Value Compiler::visitCallExpr(CallExpr& expression) {
+    emitCall(expression, OP_CALL);
+    return NONE_VALUE;
+}
+
+Value Compiler::visitFunctionExpr(FunctionExpr& expression) {
+    uint32_t index = compileFunction(expression.prototype);
+    emit(OP_CLOSURE);
+    emitInt(index);
+    return NONE_VALUE;
+}
+
+void Compiler::visitBlockStmt(BlockStmt& statement, ExecutionContext* context) {
+    if (statement.hasScope) {
+        emit(OP_PUSH_SCOPE);
+        emitShort(static_cast<uint16_t>(statement.slotCount));
+    }
+    for (const auto& s : statement.statements) {
+        compileStatement(s);
+    }
+    if (statement.hasScope) {
+        emit(OP_POP_SCOPE);
+    }
+}
+
+void Compiler::visitExpressionStmt(ExpressionStmt& statement, ExecutionContext* context) {
+    compileExpression(statement.expression);
+    emit(IsInteractive ? OP_ECHO : OP_POP);
+}
+
+void Compiler::visitVarStmt(VarStmt& statement, ExecutionContext* context) {
+    if (statement.initializer != nullptr) {
+        compileExpression(statement.initializer);
+    } else {
+        emit(OP_NONE);
+    }
+    emitDefine(statement.name, statement.slot);
+}
+
+void Compiler::visitFunctionStmt(FunctionStmt& statement, ExecutionContext* context) {
+    uint32_t index = compileFunction(statement.prototype);
+    emit(OP_CLOSURE);
+    emitInt(index);
+    emitDefine(statement.name, statement.slot);
+}
+
+void Compiler::visitReturnStmt(ReturnStmt& statement, ExecutionContext* context) {
+    auto tailCall = nodeCast<CallExpr>(statement.value);
+    if (tailCall && tailCall->isTailCall) {
+        // OP_RETURN still follows for callees that cannot replace the frame (builtins)
+        emitCall(*tailCall, OP_TAIL_CALL);
+    } else if (statement.value != nullptr) {
+        compileExpression(statement.value);
+    } else {
+        emit(OP_NONE);
+    }
+    emit(OP_RETURN);
+}
+
+void Compiler::visitIfStmt(IfStmt& statement, ExecutionContext* context) {
+    std::vector<size_t> elseJumps;
+    compileBranch(statement.condition, false, elseJumps);
+    compileStatement(statement.thenBranch);
+
+    size_t endJump = 0;
+    if (statement.elseBranch != nullptr) {
+        endJump = emitJump(OP_JUMP);
+    }
+    for (size_t jump : elseJumps) {
+        patchJump(jump);
+    }
+    if (statement.elseBranch != nullptr) {
+        compileStatement(statement.elseBranch);
+        patchJump(endJump);
+    }
+}
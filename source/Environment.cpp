@@ -1,51 +1,120 @@
 #include "../headers/Environment.h"
 #include "../headers/ErrorReporter.h"
 
+void Environment::destroy(Environment* env) {
+    if (env->collector) {
+        env->untrack();
+        env->collector = nullptr;
+    }
+    if (env->openUpvalues) {
+        env->closeUpvalues();
+    }
+    // Dropping the parent can release (and pool) the rest of the chain
+    env->parent = nullptr;
+    env->slots.clear();
+    env->variables.clear();
+    env->errorReporter = nullptr;
+
+    if (pool.free.size() < ENVIRONMENT_POOL_LIMIT) {
+        pool.free.push_back(env);
+    } else {
+        delete env;
+    }
+}
+
+UpvalueRef Environment::capture(int slot) {
+    Value* location = &slots[slot];
+    for (Upvalue* upvalue = openUpvalues; upvalue != nullptr; upvalue = upvalue->nextOpen) {
+        if (upvalue->location == location) {
+            return UpvalueRef(upvalue);
+        }
+    }
+
+    Upvalue* upvalue = new Upvalue(location, this);
+    upvalue->nextOpen = openUpvalues;
+    if (openUpvalues) openUpvalues->prevOpen = upvalue;
+    openUpvalues = upvalue;
+    return UpvalueRef(upvalue);
+}
+
+// Moves each captured value out of its slot into the upvalue, so closures
+// keep it after this scope's slots are cleared or reused
+void Environment::closeUpvalues() {
+    Upvalue* upvalue = openUpvalues;
+    while (upvalue != nullptr) {
+        Upvalue* next = upvalue->nextOpen;
+        upvalue->closed = std::move(*upvalue->location);
+        upvalue->location = &upvalue->closed;
+        upvalue->scope = nullptr;
+        upvalue->prevOpen = nullptr;
+        upvalue->nextOpen = nullptr;
+        upvalue = next;
+    }
+    openUpvalues = nullptr;
+}
+
+void Upvalue::destroy(Upvalue* upvalue) {
+    if (upvalue->scope) {
+        if (upvalue->prevOpen) upvalue->prevOpen->nextOpen = upvalue->nextOpen;
+        else upvalue->scope->openUpvalues = upvalue->nextOpen;
+        if (upvalue->nextOpen) upvalue->nextOpen->prevOpen = upvalue->prevOpen;
+    }
+    delete upvalue;
+}
+
+Environment::Pool::~Pool() {
+    for (Environment* env : free) {
+        delete env;
+    }
+}
+
 void Environment::assign(const Token& name, const Value& value) {
-    auto it = variables.find(name.lexeme);
+    auto it = variables.find(name.symbol);
     if (it != variables.end()) {
         it->second = value;
         return;
     }
     
-    if (parent != nullptr) {
-        parent->assign(name, value);
-        return;
+    if (errorReporter) {
+        errorReporter->reportError(name.line, name.column, "Runtime Error", 
+            "Undefined variable '" + std::string(name.lexeme) + "'", "");
     }
-    
+    throw std::runtime_error("Undefined variable '" + std::string(name.lexeme) + "'");
+}
+
+Value& Environment::bind(GlobalCache& cache, const Token& name) {
+    auto it = variables.find(name.symbol);
+    if (it != variables.end()) {
+        cache.epoch = epoch;
+        cache.binding = &it->second;
+        return it->second;
+    }
+
     if (errorReporter) {
         errorReporter->reportError(name.line, name.column, "Runtime Error", 
-            "Undefined variable '" + name.lexeme + "'", "");
+            "Undefined variable '" + std::string(name.lexeme) + "'", "");
     }
-    throw std::runtime_error("Undefined variable '" + name.lexeme + "'");
+    throw std::runtime_error("Undefined variable '" + std::string(name.lexeme) + "'");
 }
 
 Value Environment::get(const Token& name) {
-    auto it = variables.find(name.lexeme);
+    auto it = variables.find(name.symbol);
     if (it != variables.end()) {
         return it->second;
     }
     
-    if (parent != nullptr) {
-        return parent->get(name);
-    }
-    
     if (errorReporter) {
         errorReporter->reportError(name.line, name.column, "Runtime Error", 
-            "Undefined variable '" + name.lexeme + "'", "");
+            "Undefined variable '" + std::string(name.lexeme) + "'", "");
     }
-    throw std::runtime_error("Undefined variable '" + name.lexeme + "'");
+    throw std::runtime_error("Undefined variable '" + std::string(name.lexeme) + "'");
 }
 
 Value Environment::get(const std::string& name) {
-    auto it = variables.find(name);
+    auto it = variables.find(SymbolTable::intern(name));
     if (it != variables.end()) {
         return it->second;
     }
     
-    if (parent != nullptr) {
-        return parent->get(name);
-    }
-    
     throw std::runtime_error("Undefined variable '" + name + "'");
-} 
\ No newline at end of file
+}
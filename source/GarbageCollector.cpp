@@ -0,0 +1,107 @@
+#include "../headers/GarbageCollector.h"
+#include "../headers/Environment.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+
+GarbageCollector::~GarbageCollector() {
+    // Detach any environment that outlives the collector so its destructor
+    // leaves the list alone
+    for (Environment* env = environments; env != nullptr; env = env->gcNext) {
+        env->collector = nullptr;
+    }
+    environments = nullptr;
+
+    for (Function* function : functions) {
+        delete function;
+    }
+}
+
+void GarbageCollector::markFunction(Function* function) {
+    if (function->marked) return;
+    function->marked = true;
+    grayFunctions.push_back(function);
+}
+
+// Closures can capture one another in chains of any length, so tracing uses
+// an explicit worklist instead of recursion
+void GarbageCollector::traceReferences() {
+    while (!grayFunctions.empty()) {
+        Function* function = grayFunctions.back();
+        grayFunctions.pop_back();
+
+        for (const UpvalueRef& upvalue : function->upvalues) {
+            markValue(upvalue->value());
+        }
+    }
+}
+
+void GarbageCollector::collect() {
+    auto start = std::chrono::steady_clock::now();
+    size_t heapBefore = heapSize();
+
+    for (Function* function : functions) {
+        function->marked = false;
+    }
+
+    // Mark. Only running code holds environments, so each one is a root.
+    for (Environment* env = environments; env != nullptr; env = env->gcNext) {
+        for (const Value& value : env->slots) {
+            markValue(value);
+        }
+        for (const auto& entry : env->variables) {
+            markValue(entry.second);
+        }
+    }
+    if (rootMarker) {
+        rootMarker(*this);
+    }
+    traceReferences();
+
+    // Sweep. Deleting a function releases its upvalues, freeing the ones no
+    // surviving closure shares.
+    size_t live = 0;
+    for (Function* function : functions) {
+        if (function->marked) {
+            functions[live++] = function;
+        } else {
+            delete function;
+            stats.functionsFreed++;
+        }
+    }
+    functions.resize(live);
+    nextCollection = std::max(GC_INITIAL_THRESHOLD, live * 2);
+
+    double pauseMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    stats.collections++;
+    stats.totalPauseMs += pauseMs;
+    stats.maxPauseMs = std::max(stats.maxPauseMs, pauseMs);
+    stats.peakHeapBytes = std::max(stats.peakHeapBytes, heapBefore);
+    stats.heapBytes = heapSize();
+}
+
+size_t GarbageCollector::heapSize() const {
+    size_t bytes = functions.capacity() * sizeof(Function*);
+    for (const Function* function : functions) {
+        // A shared upvalue is counted once per closure using it
+        bytes += sizeof(Function) + function->upvalues.capacity() * (sizeof(UpvalueRef) + sizeof(Upvalue));
+    }
+    for (const Environment* env = environments; env != nullptr; env = env->gcNext) {
+        bytes += sizeof(Environment) + env->slots.capacity() * sizeof(Value) +
+                 env->variables.size() * (sizeof(std::pair<const Symbol, Value>) + sizeof(void*));
+    }
+    return bytes;
+}
+
+void GarbageCollector::printStats(std::ostream& out) const {
+    double meanPauseMs = stats.collections ? stats.totalPauseMs / stats.collections : 0.0;
+    out << std::fixed << std::setprecision(3)
+        << "[gc] collections: " << stats.collections
+        << ", functions freed: " << stats.functionsFreed
+        << ", live functions: " << functions.size() << "\n"
+        << "[gc] heap: " << heapSize() / 1024.0 << " KB now, "
+        << stats.heapBytes / 1024.0 << " KB after last collection, "
+        << std::max(stats.peakHeapBytes, heapSize()) / 1024.0 << " KB peak\n"
+        << "[gc] pause: " << stats.totalPauseMs << " ms total, "
+        << meanPauseMs << " ms mean, " << stats.maxPauseMs << " ms max" << std::endl;
+}
@@ -12,6 +12,9 @@
 #include <unordered_map>
 #include "../headers/Interpreter.h"
 #include "../headers/StdLib.h"
+#include "../headers/Compiler.h"
+#include "../headers/Numeric.h"
+#include "../headers/BinaryDispatch.h"
 #include <iostream>
 #include <chrono>
 #include <cmath>
@@ -25,65 +28,65 @@ struct ReturnContext {
 };
 
 
-Value Interpreter::visitLiteralExpr(const std::shared_ptr<LiteralExpr>& expr) {
-    if(expr->isNull) return NONE_VALUE;
-    if(expr->isNumber){
-        double num;
-        if(expr->value[1] == 'b')
-        {
-            num = binaryStringToLong(expr->value);
-        }
-        else
-        {
-            num = std::stod(expr->value);
-        }
-        return Value(num);
-    }
-    if(expr->isBoolean) {
-        if(expr->value == "true") return TRUE_VALUE;
-        if(expr->value == "false") return FALSE_VALUE;
-    }
-    return Value(expr->value);
+Value Interpreter::visitLiteralExpr(LiteralExpr& expr) {
+    return expr.value;
 }
 
-Value Interpreter::visitGroupingExpr(const std::shared_ptr<GroupingExpr>& expression) {
+Value Interpreter::visitGroupingExpr(GroupingExpr& expression) {
 
-    return evaluate(expression->expression);
+    return evaluate(expression.expression);
+}
+
+Value Interpreter::visitUnaryExpr(UnaryExpr& expression)
+{
+    Value right = evaluate(expression.right);
+    switch (expression.quick) {
+        case QuickOp::NegateNumber: {
+            Value result;
+            if (right.isNumber() && numberUnary(MINUS, right, result)) return result;
+            expression.quick = QuickOp::Generic;
+            break;
+        }
+        case QuickOp::Unspecialized:
+            expression.quick = quickenUnary(expression.oper.type, right);
+            break;
+        default:
+            break;
+    }
+    return unaryOperation(expression.oper, right);
 }
 
-Value Interpreter::visitUnaryExpr(const std::shared_ptr<UnaryExpr>& expression)
+Value Interpreter::unaryOperation(const Token& oper, const Value& right)
 {
-    Value right = evaluate(expression->right);
 
-    if(expression->oper.type == MINUS)
+    Value result;
+    if(oper.type == MINUS)
     {
-        if(right.isNumber())
+        if(right.isNumber() && numberUnary(MINUS, right, result))
         {
-            double value = right.asNumber();
-            return Value(-value);
+            return result;
         }
         else
         {
-            throw std::runtime_error("Operand must be a number when using: " + expression->oper.lexeme);
+            throw std::runtime_error("Operand must be a number when using: " + std::string(oper.lexeme));
         }
 
     }
 
-    if(expression->oper.type == BANG)
+    if(oper.type == BANG)
     {
         return Value(!isTruthy(right));
     }
 
-    if(expression->oper.type == BIN_NOT)
+    if(oper.type == BIN_NOT)
     {
-        if(right.isNumber())
+        if(right.isNumber() && numberUnary(BIN_NOT, right, result))
         {
-            double value = right.asNumber();
-            return Value(static_cast<double>(~(static_cast<long>(value))));
+            return result;
         }
         else
         {
-            throw std::runtime_error("Operand must be an int when using: " + expression->oper.lexeme);
+            throw std::runtime_error("Operand must be an int when using: " + std::string(oper.lexeme));
         }
     }
 
@@ -92,556 +95,286 @@ Value Interpreter::visitUnaryExpr(const std::shared_ptr<UnaryExpr>& expression)
 
 }
 
-Value Interpreter::visitBinaryExpr(const std::shared_ptr<BinaryExpr>& expression) {
-    Value left = evaluate(expression->left);
-    Value right = evaluate(expression->right);
-
-    if (left.isNumber() && right.isNumber()) {
-        double leftNum = left.asNumber();
-        double rightNum = right.asNumber();
-
-        switch (expression->oper.type) {
-            case PLUS: return Value(leftNum + rightNum);
-            case MINUS: return Value(leftNum - rightNum);
-            case SLASH: {
-                if (rightNum == 0) {
-                    if (errorReporter) {
-                        errorReporter->reportError(expression->oper.line, expression->oper.column, "Division by Zero", 
-                            "Cannot divide by zero", expression->oper.lexeme);
-                    }
-                    throw std::runtime_error("Division by zero");
-                }
-                return Value(leftNum / rightNum);
-            }
-            case STAR: return Value(leftNum * rightNum);
-            case PERCENT: {
-                if (rightNum == 0) {
-                    if (errorReporter) {
-                        errorReporter->reportError(expression->oper.line, expression->oper.column, "Modulo by Zero", 
-                            "Cannot perform modulo operation with zero", expression->oper.lexeme);
-                    }
-                    throw std::runtime_error("Modulo by zero");
-                }
-                return Value(std::fmod(leftNum, rightNum));
-            }
-            case GREATER: return Value(leftNum > rightNum);
-            case GREATER_EQUAL: return Value(leftNum >= rightNum);
-            case LESS: return Value(leftNum < rightNum);
-            case LESS_EQUAL: return Value(leftNum <= rightNum);
-            case DOUBLE_EQUAL: return Value(leftNum == rightNum);
-            case BANG_EQUAL: return Value(leftNum != rightNum);
-            case BIN_AND: return Value(static_cast<double>(static_cast<int>(leftNum) & static_cast<int>(rightNum)));
-            case BIN_OR: return Value(static_cast<double>(static_cast<int>(leftNum) | static_cast<int>(rightNum)));
-            case BIN_XOR: return Value(static_cast<double>(static_cast<int>(leftNum) ^ static_cast<int>(rightNum)));
-            case BIN_SLEFT: return Value(static_cast<double>(static_cast<int>(leftNum) << static_cast<int>(rightNum)));
-            case BIN_SRIGHT: return Value(static_cast<double>(static_cast<int>(leftNum) >> static_cast<int>(rightNum)));
-            case AND: {
-                if (!isTruthy(left)) {
-                    return left; // Return the falsy value
-                } else {
-                    return right; // Return the second value
-                }
-            }
-            case OR: {
-                if (isTruthy(left)) {
-                    return left; // Return the truthy value
-                } else {
-                    return right; // Return the second value
-                }
-            }
-        }
-    }
-
-    if (left.isString() && right.isString()) {
-        std::string left_string = left.asString();
-        std::string right_string = right.asString();
-        
-        switch (expression->oper.type) {
-            case PLUS: return Value(left_string + right_string);
-            case DOUBLE_EQUAL: return Value(left_string == right_string);
-            case BANG_EQUAL: return Value(left_string != right_string);
-            case AND: {
-                if (!isTruthy(left)) {
-                    return left; // Return the falsy value
-                } else {
-                    return right; // Return the second value
-                }
-            }
-            case OR: {
-                if (isTruthy(left)) {
-                    return left; // Return the truthy value
-                } else {
-                    return right; // Return the second value
-                }
-            }
-            default:
-                if (errorReporter) {
-                    errorReporter->reportError(expression->oper.line, expression->oper.column, "Runtime Error", 
-                        "Cannot use '" + expression->oper.lexeme + "' on two strings", expression->oper.lexeme);
-                }
-                throw std::runtime_error("Cannot use '" + expression->oper.lexeme + "' on two strings");
-        }
-    }
-
-    if (left.isString() && right.isNumber()) {
-        std::string left_string = left.asString();
-        double right_num = right.asNumber();
-        
-        switch (expression->oper.type) {
-            case PLUS: return left + right;
-            case STAR: {
-                if (!isWholeNumer(right_num)) {
-                    if (errorReporter) {
-                        errorReporter->reportError(expression->oper.line, expression->oper.column, "Invalid String Multiplication", 
-                            "String multiplier must be a whole number", expression->oper.lexeme);
-                    }
-                    throw std::runtime_error("String multiplier must be whole number");
-                }
-                std::string result;
-                for (int i = 0; i < static_cast<int>(right_num); i++) {
-                    result += left_string;
-                }
-                return Value(result);
-            }
-        }
-    }
-
-    if (left.isNumber() && right.isString()) {
-        double left_num = left.asNumber();
-        std::string right_string = right.asString();
-        
-        switch (expression->oper.type) {
-            case PLUS: return left + right;
-            case STAR: {
-                if (!isWholeNumer(left_num)) {
-                    if (errorReporter) {
-                        errorReporter->reportError(expression->oper.line, expression->oper.column, "Invalid String Multiplication", 
-                            "String multiplier must be a whole number", expression->oper.lexeme);
-                    }
-                    throw std::runtime_error("String multiplier must be whole number");
-                }
-                std::string result;
-                for (int i = 0; i < static_cast<int>(left_num); i++) {
-                    result += right_string;
-                }
-                return Value(result);
-            }
-        }
-    }
-
-    if (left.isBoolean() && right.isBoolean()) {
-        bool left_bool = left.asBoolean();
-        bool right_bool = right.asBoolean();
-        
-        switch (expression->oper.type) {
-            case AND: return Value(left_bool && right_bool);
-            case OR: return Value(left_bool || right_bool);
-            case DOUBLE_EQUAL: return Value(left_bool == right_bool);
-            case BANG_EQUAL: return Value(left_bool != right_bool);
-        }
-    }
-
-
-
-    if (left.isBoolean() && right.isString()) {
-        bool left_bool = left.asBoolean();
-        std::string right_string = right.asString();
-        
-        switch (expression->oper.type) {
-            case PLUS: return left + right;
-        }
-    }
-
-    if (left.isString() && right.isBoolean()) {
-        std::string left_string = left.asString();
-        bool right_bool = right.asBoolean();
-        
-        switch (expression->oper.type) {
-            case PLUS: return left + right;
-        }
-    }
-
-    if (left.isNumber() && right.isBoolean()) {
-        double left_num = left.asNumber();
-        bool right_bool = right.asBoolean();
-        
-        switch (expression->oper.type) {
-            case AND: {
-                if (!isTruthy(left)) {
-                    return left; // Return the falsy value
-                } else {
-                    return right; // Return the second value
-                }
-            }
-            case OR: {
-                if (isTruthy(left)) {
-                    return left; // Return the truthy value
-                } else {
-                    return right; // Return the second value
-                }
+Value Interpreter::visitBinaryExpr(BinaryExpr& expression) {
+    Value left = evaluate(expression.left);
+    bool rootLeft = left.isFunction();
+    if (rootLeft) tempRoots.push_back(left);
+    Value right = evaluate(expression.right);
+    if (rootLeft) tempRoots.pop_back();
+
+    // The node specializes itself on the operand types of its first
+    // evaluation and skips type dispatch while they keep matching
+    if (expression.quick != QuickOp::Generic) {
+        if (expression.quick == QuickOp::Unspecialized) {
+            expression.quick = quickenBinary(expression.oper.type, left, right);
+        } else {
+            Value result;
+            if (quickBinary(expression.quick, left, right, result)) {
+                return result;
             }
+            expression.quick = QuickOp::Generic;
         }
     }
+    return binaryOperation(expression.oper, left, right);
+}
 
-    if (left.isBoolean() && right.isNumber()) {
-        bool left_bool = left.asBoolean();
-        double right_num = right.asNumber();
-        
-        switch (expression->oper.type) {
-            case AND: {
-                if (!isTruthy(left)) {
-                    return left; // Return the falsy value
-                } else {
-                    return right; // Return the second value
-                }
-            }
-            case OR: {
-                if (isTruthy(left)) {
-                    return left; // Return the truthy value
-                } else {
-                    return right; // Return the second value
-                }
-            }
-        }
-    }
-
-    // Mixed-type logical operations (string && boolean, etc.)
-    if (left.isString() && right.isBoolean()) {
-        bool right_bool = right.asBoolean();
-        
-        switch (expression->oper.type) {
-            case AND: {
-                if (!isTruthy(left)) {
-                    return left; // Return the falsy value
-                } else {
-                    return right; // Return the second value
-                }
-            }
-            case OR: {
-                if (isTruthy(left)) {
-                    return left; // Return the truthy value
-                } else {
-                    return right; // Return the second value
-                }
-            }
-            case PLUS: return left + right;
-        }
-    }
-
-    if (left.isBoolean() && right.isString()) {
-        bool left_bool = left.asBoolean();
-        
-        switch (expression->oper.type) {
-            case AND: {
-                if (!isTruthy(left)) {
-                    return left; // Return the falsy value
-                } else {
-                    return right; // Return the second value
-                }
-            }
-            case OR: {
-                if (isTruthy(left)) {
-                    return left; // Return the truthy value
-                } else {
-                    return right; // Return the second value
-                }
-            }
-            case PLUS: return left + right;
-        }
-    }
-
-    if (left.isString() && right.isNumber()) {
-        double right_num = right.asNumber();
-        
-        switch (expression->oper.type) {
-            case AND: {
-                if (!isTruthy(left)) {
-                    return left; // Return the falsy value
-                } else {
-                    return right; // Return the second value
-                }
-            }
-            case OR: {
-                if (isTruthy(left)) {
-                    return left; // Return the truthy value
-                } else {
-                    return right; // Return the second value
-                }
-            }
-            case PLUS: return left + right;
-            case STAR: {
-                if (!isWholeNumer(right_num)) {
-                    if (errorReporter) {
-                        errorReporter->reportError(expression->oper.line, expression->oper.column, "Invalid String Multiplication", 
-                            "String multiplier must be a whole number");
-                    }
-                    throw std::runtime_error("String multiplier must be whole number");
-                }
-                std::string result;
-                for (int i = 0; i < static_cast<int>(right_num); i++) {
-                    result += left.asString();
-                }
-                return Value(result);
-            }
-        }
+Value Interpreter::visitLogicalExpr(LogicalExpr& expression) {
+    Value left = evaluate(expression.left);
+    bool decided = expression.oper.type == OR ? isTruthy(left) : !isTruthy(left);
+    if (decided) {
+        return left;
     }
+    return evaluate(expression.right);
+}
 
-    if (left.isNumber() && right.isString()) {
-        double left_num = left.asNumber();
-        
-        switch (expression->oper.type) {
-            case AND: {
-                if (!isTruthy(left)) {
-                    return left; // Return the falsy value
-                } else {
-                    return right; // Return the second value
-                }
-            }
-            case OR: {
-                if (isTruthy(left)) {
-                    return left; // Return the truthy value
-                } else {
-                    return right; // Return the second value
-                }
-            }
-            case PLUS: return left + right;
-            case STAR: {
-                if (!isWholeNumer(left_num)) {
-                    if (errorReporter) {
-                        errorReporter->reportError(expression->oper.line, expression->oper.column, "Invalid String Multiplication", 
-                            "String multiplier must be a whole number");
-                    }
-                    throw std::runtime_error("String multiplier must be whole number");
-                }
-                std::string result;
-                for (int i = 0; i < static_cast<int>(left_num); i++) {
-                    result += right.asString();
-                }
-                return Value(result);
-            }
-        }
+// Truthiness of an and/or chain used as a condition. Nested logical operands
+// are followed directly, so only the leaves produce values.
+bool Interpreter::isConditionTrue(LogicalExpr& expression) {
+    bool left = expression.leftLogical ? isConditionTrue(*expression.leftLogical)
+                                       : isTruthy(evaluate(expression.left));
+    if (expression.oper.type == OR ? left : !left) {
+        return left;
     }
+    return expression.rightLogical ? isConditionTrue(*expression.rightLogical)
+                                   : isTruthy(evaluate(expression.right));
+}
 
-    if (left.isNone() && right.isString()) {
-        std::string right_string = right.asString();
-        
-        switch (expression->oper.type) {
-            case PLUS: return left + right;
-        }
-        if (errorReporter) {
-            errorReporter->reportError(expression->oper.line, expression->oper.column, "Runtime Error", 
-                "Cannot use '" + expression->oper.lexeme + "' on none and a string", expression->oper.lexeme);
-        }
-        throw std::runtime_error("Cannot use '" + expression->oper.lexeme + "' on none and a string");
-    }
-    
-    if (left.isString() && right.isNone()) {
-        std::string left_string = left.asString();
-        
-        switch (expression->oper.type) {
-            case PLUS: return left + right;
-        }
-        if (errorReporter) {
-            errorReporter->reportError(expression->oper.line, expression->oper.column, "Runtime Error", 
-                "Cannot use '" + expression->oper.lexeme + "' on a string and none", expression->oper.lexeme);
-        }
-        throw std::runtime_error("Cannot use '" + expression->oper.lexeme + "' on a string and none");
-    }
-    else
-    {
-        if (errorReporter) {
-            errorReporter->reportError(expression->oper.line, expression->oper.column, "Runtime Error", 
-                "Operands must be of same type when using: " + expression->oper.lexeme, expression->oper.lexeme);
-        }
-        throw std::runtime_error("Operands must be of same type when using: " + expression->oper.lexeme);
-    }
+// Both backends' generic path; quickened sites fall back to it
+Value Interpreter::binaryOperation(const Token& oper, const Value& left, const Value& right) {
+    return dispatchBinary(oper, left, right, errorReporter);
 }
 
-Value Interpreter::visitVarExpr(const std::shared_ptr<VarExpr>& expression)
+Value Interpreter::visitVarExpr(VarExpr& expression)
 {
-    return environment->get(expression->name);
+    if (expression.upvalue >= 0) {
+        return upvalue(expression.upvalue, expression.global, expression.name);
+    }
+    if (expression.depth < 0) {
+        return globals->lookup(expression.global, expression.name);
+    }
+    return local(expression.depth, expression.slot);
 }
 
-Value Interpreter::visitIncrementExpr(const std::shared_ptr<IncrementExpr>& expression) {
+Value Interpreter::visitIncrementExpr(IncrementExpr& expression) {
     // Get the current value of the operand
-    Value currentValue = evaluate(expression->operand);
+    Value currentValue = evaluate(expression.operand);
     
     if (!currentValue.isNumber()) {
         if (errorReporter) {
-            errorReporter->reportError(expression->oper.line, expression->oper.column, 
+            errorReporter->reportError(expression.oper.line, expression.oper.column, 
                 "Runtime Error", "Increment/decrement can only be applied to numbers.", "");
         }
         throw std::runtime_error("Increment/decrement can only be applied to numbers.");
     }
     
-    double currentNum = currentValue.asNumber();
-    double newValue;
-    
-    // Determine the operation based on the operator
-    if (expression->oper.type == PLUS_PLUS) {
-        newValue = currentNum + 1.0;
-    } else if (expression->oper.type == MINUS_MINUS) {
-        newValue = currentNum - 1.0;
-    } else {
-        if (errorReporter) {
-            errorReporter->reportError(expression->oper.line, expression->oper.column, 
-                "Runtime Error", "Invalid increment/decrement operator.", "");
-        }
-        throw std::runtime_error("Invalid increment/decrement operator.");
-    }
+    Value newValue = incrementOperation(expression.oper, currentValue);
     
     // Update the variable if it's a variable expression
-    if (auto varExpr = std::dynamic_pointer_cast<VarExpr>(expression->operand)) {
-        environment->assign(varExpr->name, Value(newValue));
+    if (auto varExpr = nodeCast<VarExpr>(expression.operand)) {
+        if (expression.upvalue >= 0) {
+            upvalue(expression.upvalue, varExpr->global, varExpr->name) = newValue;
+        } else if (expression.depth < 0) {
+            globals->lookup(varExpr->global, varExpr->name) = newValue;
+        } else {
+            local(expression.depth, expression.slot) = newValue;
+        }
     } else {
         if (errorReporter) {
-            errorReporter->reportError(expression->oper.line, expression->oper.column, 
+            errorReporter->reportError(expression.oper.line, expression.oper.column, 
                 "Runtime Error", "Increment/decrement can only be applied to variables.", "");
         }
         throw std::runtime_error("Increment/decrement can only be applied to variables.");
     }
     
     // Return the appropriate value based on prefix/postfix
-    if (expression->isPrefix) {
-        return Value(newValue);  // Prefix: return new value
+    if (expression.isPrefix) {
+        return newValue;         // Prefix: return new value
     } else {
         return currentValue;     // Postfix: return old value
     }
 }
 
+Value Interpreter::incrementOperation(const Token& oper, const Value& currentValue) {
+    // Determine the operation based on the operator
+    if (oper.type == PLUS_PLUS) {
+        return numberStep(currentValue, 1);
+    } else if (oper.type == MINUS_MINUS) {
+        return numberStep(currentValue, -1);
+    }
+
+    if (errorReporter) {
+        errorReporter->reportError(oper.line, oper.column,
+            "Runtime Error", "Invalid increment/decrement operator.", "");
+    }
+    throw std::runtime_error("Invalid increment/decrement operator.");
+}
+
 void Interpreter::addStdLibFunctions() {
     // Add standard library functions to the environment
-            StdLib::addToEnvironment(environment, *this, errorReporter);
+            StdLib::addToEnvironment(globals, *this, errorReporter);
 }
 
 void Interpreter::addBuiltinFunction(std::shared_ptr<BuiltinFunction> func) {
     builtinFunctions.push_back(func);
 }
 
-Value Interpreter::visitAssignExpr(const std::shared_ptr<AssignExpr>& expression) {
-    Value value = evaluate(expression->value);
-    
-    switch (expression->op.type) {
-        case PLUS_EQUAL:
-        case MINUS_EQUAL:
-        case STAR_EQUAL:
-        case SLASH_EQUAL:
-        case PERCENT_EQUAL:
-        case BIN_AND_EQUAL:
-        case BIN_OR_EQUAL:
-        case BIN_XOR_EQUAL:
-        case BIN_SLEFT_EQUAL:
-        case BIN_SRIGHT_EQUAL: {
-            Value currentValue = environment->get(expression->name.lexeme);
-            switch (expression->op.type) {
-                case PLUS_EQUAL:
-                    value = currentValue + value;
-                    break;
-                case MINUS_EQUAL:
-                    value = currentValue - value;
-                    break;
-                case STAR_EQUAL:
-                    value = currentValue * value;
-                    break;
-                case SLASH_EQUAL:
-                    value = currentValue / value;
-                    break;
-                case PERCENT_EQUAL:
-                    value = currentValue % value;
-                    break;
-                case BIN_AND_EQUAL:
-                    value = currentValue & value;
-                    break;
-                case BIN_OR_EQUAL:
-                    value = currentValue | value;
-                    break;
-                case BIN_XOR_EQUAL:
-                    value = currentValue ^ value;
-                    break;
-                case BIN_SLEFT_EQUAL:
-                    value = currentValue << value;
-                    break;
-                case BIN_SRIGHT_EQUAL:
-                    value = currentValue >> value;
-                    break;
-                default:
-                    break;
-            }
-            break;
-        }
-        default:
-            break;
+Value Interpreter::visitAssignExpr(AssignExpr& expression) {
+    Value value = evaluate(expression.value);
+    Value& variable = expression.upvalue >= 0 ? upvalue(expression.upvalue, expression.global, expression.name)
+        : expression.depth < 0 ? globals->lookup(expression.global, expression.name)
+        : local(expression.depth, expression.slot);
+
+    if (expression.op.type == EQUAL) {
+        variable = value;
+        return value;
+    }
+    if (expression.op.type != PLUS_EQUAL || !variable.appendInPlace(value)) {
+        variable = binaryOperation(expression.op, variable, value);
     }
-    environment->assign(expression->name, value);
-    return value;
+    return variable;
 }
 
-Value Interpreter::visitCallExpr(const std::shared_ptr<CallExpr>& expression) {
-    Value callee = evaluate(expression->callee);
-    
-    std::vector<Value> arguments;
-    for (const std::shared_ptr<Expr>& argument : expression->arguments) {
-        arguments.push_back(evaluate(argument));
+Value Interpreter::visitCallExpr(CallExpr& expression) {
+    size_t base = pushCall(expression);
+    return call(base, expression.arguments.size(), expression.paren);
+}
+
+// Evaluates the callee and then the arguments onto the call stack and
+// returns the callee's index
+size_t Interpreter::pushCall(CallExpr& expression) {
+    size_t base = callStack.size();
+    callStack.push_back(evaluate(expression.callee));
+    for (Expr* argument : expression.arguments) {
+        callStack.push_back(evaluate(argument));
     }
-    
+    return base;
+}
+
+// Calls the callee at callStack[base] with the argCount values above it and
+// pops them all. Builtins read the arguments in place.
+Value Interpreter::call(size_t base, size_t argCount, const Token& paren) {
+    const Value& callee = callStack[base];
     if (callee.isBuiltinFunction()) {
         // Builtin functions now work directly with Value and receive line and column
-        return callee.asBuiltinFunction()->func(arguments, expression->paren.line, expression->paren.column);
+        BuiltinFunction* builtin = callee.asBuiltinFunction();
+        if (profiler) profiler->enter(builtin->name);
+        Value result = builtin->func(Arguments{callStack.data() + base + 1, argCount}, paren.line, paren.column);
+        if (profiler) profiler->exit();
+        callStack.resize(base);
+        return result;
     }
     
     if (callee.isFunction()) {
-        Function* function = callee.asFunction();
-        if (arguments.size() != function->params.size()) {
-            throw std::runtime_error("Expected " + std::to_string(function->params.size()) +
-                                   " arguments but got " + std::to_string(arguments.size()) + ".");
-        }
-        
-        auto previousEnv = environment;
-        environment = std::make_shared<Environment>(function->closure);
-        environment->setErrorReporter(errorReporter);
-        
-        for (size_t i = 0; i < function->params.size(); i++) {
-            environment->define(function->params[i], arguments[i]);
+        return callFunction(base, argCount);
+    }
+    
+    throw std::runtime_error("Can only call functions and classes.");
+}
+
+// Runs a user function. Tail calls made from its body are handed back through
+// the ExecutionContext and run in this same loop, so chains of self or mutual
+// tail calls use constant C++ stack. A frame no closure captures keeps its
+// slots on callStack right after the callee, where the arguments already
+// are; a captured frame gets an Environment, reused by each tail call.
+Value Interpreter::callFunction(size_t base, size_t argCount) {
+    // The running function stays at callStack[base], which keeps it alive
+    // for the collector while its body executes
+    Function* function = callStack[base].asFunction();
+    size_t argBase = base + 1;
+    EnvironmentRef previousEnv = environment;
+    Function* previousFunction = currentFunction;
+    bool previousOnStack = frameOnStack;
+    size_t previousBase = frameBase;
+    EnvironmentRef callEnv;
+    if (profiler) profiler->enter(function->prototype->name);
+    
+    ExecutionContext context;
+    context.isFunctionBody = true;
+    
+    for (;;) {
+        const FunctionPrototype& prototype = *function->prototype;
+        if (argCount != prototype.params.size()) {
+            throw std::runtime_error("Expected " + std::to_string(prototype.params.size()) +
+                                   " arguments but got " + std::to_string(argCount) + ".");
         }
         
-        ExecutionContext context;
-        context.isFunctionBody = true;
+        if (prototype.frameCaptured) {
+            // Frames hang off the globals only so the collector tracks them;
+            // everything a function reaches outside its frame is an upvalue
+            if (callEnv && callEnv.useCount() == 1) {
+                callEnv->resetSlots(prototype.slotCount);
+            } else {
+                callEnv = Environment::create(globals, prototype.slotCount);
+            }
+            for (size_t i = 0; i < argCount; i++) {
+                callEnv->slot(static_cast<int>(i)) = std::move(callStack[argBase + i]);
+            }
+            callStack.resize(base + 1);
+            environment = callEnv;
+        } else {
+            if (argBase != base + 1) {
+                for (size_t i = 0; i < argCount; i++) {
+                    callStack[base + 1 + i] = std::move(callStack[argBase + i]);
+                }
+            }
+            // Drop what a previous frame left beyond the arguments, then add the locals
+            callStack.resize(base + 1 + argCount);
+            callStack.resize(base + 1 + prototype.slotCount);
+            frameBase = base + 1;
+            callEnv = nullptr;
+        }
+        frameOnStack = !prototype.frameCaptured;
+        currentFunction = function;
         
-        for (const auto& stmt : function->body) {
+        for (const auto& stmt : prototype.body) {
             execute(stmt, &context);
             if (context.hasReturn) {
-                environment = previousEnv;
-                return context.returnValue;
+                break;
             }
         }
-        
         environment = previousEnv;
-        return context.returnValue;
+        currentFunction = previousFunction;
+        frameOnStack = previousOnStack;
+        frameBase = previousBase;
+        
+        if (context.tailCallee == nullptr) {
+            callStack.resize(base);
+            if (profiler) profiler->exit();
+            return context.returnValue;
+        }
+        
+        // The tail callee and its arguments were left on top of the stack
+        function = context.tailCallee;
+        argCount = context.tailArgumentCount;
+        argBase = callStack.size() - argCount;
+        callStack[base] = Value(function);
+        if (profiler) profiler->tailCall(function->prototype->name);
+        context.tailCallee = nullptr;
+        context.tailArgumentCount = 0;
+        context.hasReturn = false;
+        context.returnValue = NONE_VALUE;
     }
-    
-    throw std::runtime_error("Can only call functions and classes.");
 }
 
-Value Interpreter::visitFunctionExpr(const std::shared_ptr<FunctionExpr>& expression) {
-    // Convert Token parameters to string parameters
-    std::vector<std::string> paramNames;
-    for (const Token& param : expression->params) {
-        paramNames.push_back(param.lexeme);
-    }
-    
-    auto function = msptr(Function)("anonymous", paramNames, expression->body, environment);
-    functions.push_back(function); // Keep the shared_ptr alive
-    return Value(function.get());
+Value Interpreter::visitFunctionExpr(FunctionExpr& expression) {
+    return Value(gc.newFunction(&expression.prototype, environment.get(), currentFunction));
 }
 
-void Interpreter::visitBlockStmt(const std::shared_ptr<BlockStmt>& statement, ExecutionContext* context) {
-    auto newEnv = std::make_shared<Environment>(environment);
-    newEnv->setErrorReporter(errorReporter);
-    executeBlock(statement->statements, newEnv, context);
+void Interpreter::visitBlockStmt(BlockStmt& statement, ExecutionContext* context) {
+    if (statement.hasScope) {
+        executeBlock(statement.statements, Environment::create(environment, statement.slotCount), context);
+        return;
+    }
+    for (Stmt* s : statement.statements) {
+        execute(s, context);
+        if (context && context->hasReturn) {
+            return;
+        }
+    }
 }
 
-void Interpreter::visitExpressionStmt(const std::shared_ptr<ExpressionStmt>& statement, ExecutionContext* context) {
-    Value value = evaluate(statement->expression);
+void Interpreter::visitExpressionStmt(ExpressionStmt& statement, ExecutionContext* context) {
+    Value value = evaluate(statement.expression);
 
     if(IsInteractive)
         std::cout << "\u001b[38;5;8m[" << stringify(value) << "]\u001b[38;5;15m" << std::endl;
@@ -649,40 +382,49 @@ void Interpreter::visitExpressionStmt(const std::shared_ptr<ExpressionStmt>& sta
 
 
 
-void Interpreter::visitVarStmt(const std::shared_ptr<VarStmt>& statement, ExecutionContext* context)
+void Interpreter::visitVarStmt(VarStmt& statement, ExecutionContext* context)
 {
     Value value = NONE_VALUE;
-    if(statement->initializer != nullptr)
+    if(statement.initializer != nullptr)
     {
-        value = evaluate(statement->initializer);
+        value = evaluate(statement.initializer);
     }
 
-    //std::cout << "Visit var stmt: " << statement->name.lexeme << " set to: " << stringify(value) << std::endl;
+    //std::cout << "Visit var stmt: " << statement.name.lexeme << " set to: " << stringify(value) << std::endl;
 
-    environment->define(statement->name.lexeme, value);
+    if (statement.slot < 0) {
+        globals->define(statement.name.symbol, value);
+    } else {
+        local(0, statement.slot) = value;
+    }
 }
 
-void Interpreter::visitFunctionStmt(const std::shared_ptr<FunctionStmt>& statement, ExecutionContext* context)
+void Interpreter::visitFunctionStmt(FunctionStmt& statement, ExecutionContext* context)
 {
-    // Convert Token parameters to string parameters
-    std::vector<std::string> paramNames;
-    for (const Token& param : statement->params) {
-        paramNames.push_back(param.lexeme);
+    Function* function = gc.newFunction(&statement.prototype, environment.get(), currentFunction);
+    if (statement.slot < 0) {
+        globals->define(statement.name.symbol, Value(function));
+    } else {
+        local(0, statement.slot) = Value(function);
     }
-    
-    auto function = msptr(Function)(statement->name.lexeme, 
-                                   paramNames, 
-                                   statement->body, 
-                                   environment);
-    functions.push_back(function); // Keep the shared_ptr alive
-    environment->define(statement->name.lexeme, Value(function.get()));
 }
 
-void Interpreter::visitReturnStmt(const std::shared_ptr<ReturnStmt>& statement, ExecutionContext* context)
+void Interpreter::visitReturnStmt(ReturnStmt& statement, ExecutionContext* context)
 {
     Value value = NONE_VALUE;
-    if (statement->value != nullptr) {
-        value = evaluate(statement->value);
+    auto* tailCall = nodeCast<CallExpr>(statement.value);
+    if (tailCall && tailCall->isTailCall && context && context->isFunctionBody) {
+        size_t base = pushCall(*tailCall);
+        if (callStack[base].isFunction()) {
+            // Let the enclosing callFunction loop run it in place of this frame
+            context->hasReturn = true;
+            context->tailCallee = callStack[base].asFunction();
+            context->tailArgumentCount = tailCall->arguments.size();
+            return;
+        }
+        value = call(base, tailCall->arguments.size(), tailCall->paren);
+    } else if (statement.value != nullptr) {
+        value = evaluate(statement.value);
     }
     
     if (context && context->isFunctionBody) {
@@ -692,49 +434,63 @@ void Interpreter::visitReturnStmt(const std::shared_ptr<ReturnStmt>& statement,
     // If no context or not in function body, this is a top-level return (ignored)
 }
 
-void Interpreter::visitIfStmt(const std::shared_ptr<IfStmt>& statement, ExecutionContext* context)
+void Interpreter::visitIfStmt(IfStmt& statement, ExecutionContext* context)
 {
-    if (isTruthy(evaluate(statement->condition))) {
-        execute(statement->thenBranch, context);
-    } else if (statement->elseBranch != nullptr) {
-        execute(statement->elseBranch, context);
+    bool condition = statement.logicalCondition ? isConditionTrue(*statement.logicalCondition)
+                                                : isTruthy(evaluate(statement.condition));
+    if (condition) {
+        execute(statement.thenBranch, context);
+    } else if (statement.elseBranch != nullptr) {
+        execute(statement.elseBranch, context);
     }
 }
 
-void Interpreter::interpret(std::vector<std::shared_ptr<Stmt> > statements) {
-    for(const std::shared_ptr<Stmt>& s : statements)
+void Interpreter::interpret(const std::vector<Stmt*>& statements) {
+    // Drop anything left behind by an earlier failed REPL line
+    tempRoots.clear();
+    callStack.clear();
+    currentFunction = nullptr;
+    frameOnStack = false;
+    if (profiler) profiler->unwind();
+    if (useBytecode) {
+        Compiler compiler(IsInteractive);
+        vm.run(compiler.compile(statements), globals);
+        return;
+    }
+
+    for(Stmt* s : statements)
     {
         execute(s, nullptr); // No context needed for top-level execution
     }
 }
 
-void Interpreter::execute(const std::shared_ptr<Stmt>& statement, ExecutionContext* context)
+void Interpreter::execute(Stmt* statement, ExecutionContext* context)
 {
-    statement->accept(this, context);
+    visitStmt(*this, *statement, context);
 }
 
-void Interpreter::executeBlock(std::vector<std::shared_ptr<Stmt> > statements, std::shared_ptr<Environment> env, ExecutionContext* context)
+void Interpreter::executeBlock(const std::vector<Stmt*>& statements, EnvironmentRef env, ExecutionContext* context)
 {
-    std::shared_ptr<Environment> previous = this->environment;
-    this->environment = env;
+    EnvironmentRef previous = std::move(this->environment);
+    this->environment = std::move(env);
 
-    for(const std::shared_ptr<Stmt>& s : statements)
+    for(Stmt* s : statements)
     {
         execute(s, context);
         if (context && context->hasReturn) {
-            this->environment = previous;
+            this->environment = std::move(previous);
             return;
         }
     }
 
-    this->environment = previous;
+    this->environment = std::move(previous);
 }
 
-Value Interpreter::evaluate(const std::shared_ptr<Expr>& expr) {
-    return expr->accept(this);
+Value Interpreter::evaluate(Expr* expr) {
+    return visitExpr(*this, *expr);
 }
 
-bool Interpreter::isTruthy(Value object) {
+bool Interpreter::isTruthy(const Value& object) {
 
     if(object.isBoolean())
     {
@@ -759,12 +515,12 @@ bool Interpreter::isTruthy(Value object) {
     return true;
 }
 
-bool Interpreter::isEqual(Value a, Value b) {
+bool Interpreter::isEqual(const Value& a, const Value& b) {
     if(a.isNumber())
     {
         if(b.isNumber())
         {
-            return a.asNumber() == b.asNumber();
+            return a.equals(b);
         }
 
         return false;
@@ -782,7 +538,7 @@ bool Interpreter::isEqual(Value a, Value b) {
     {
         if(b.isString())
         {
-            return a.asString() == b.asString();
+            return a.equals(b);
         }
 
         return false;
@@ -800,11 +556,15 @@ bool Interpreter::isEqual(Value a, Value b) {
     throw std::runtime_error("Invalid isEqual compariosn");
 }
 
-std::string Interpreter::stringify(Value object) {
+std::string Interpreter::stringify(const Value& object) {
     if(object.isNone())
     {
         return "none";
     }
+    else if(object.isInteger())
+    {
+        return std::to_string(object.asInteger());
+    }
     else if(object.isNumber())
     {
         double integral = object.asNumber();
@@ -838,7 +598,7 @@ std::string Interpreter::stringify(Value object) {
     }
     else if(object.isFunction())
     {
-        return "<function " + object.asFunction()->name + ">";
+        return "<function " + object.asFunction()->prototype->name + ">";
     }
     else if(object.isBuiltinFunction())
     {
@@ -848,19 +608,6 @@ std::string Interpreter::stringify(Value object) {
     throw std::runtime_error("Could not convert object to string");
 }
 
-bool Interpreter::isWholeNumer(double num) {
-    double integral = num;
-    double fractional = std::modf(num, &integral);
-
-    if(std::abs(fractional) < std::numeric_limits<double>::epsilon())
-    {
-        return true;
-    }
-    else
-    {
-        return false;
-    }
-}
 
 
 
@@ -8,296 +8,203 @@ using namespace std;
 
 std::vector<Token> Lexer::Tokenize(std::string source){
     std::vector<Token> tokens;
-    src = std::vector<char>{source.begin(), source.end()};
+    sources.push_back(std::move(source));
+    src = sources.back();
+    current = 0;
     line = 1;
     column = 1;
 
-    while(!src.empty())
+    while(!isAtEnd())
     {
-        char t = src[0];
+        char t = src[current];
+        size_t start = current;
+        auto lexeme = [&]() { return src.substr(start, current - start); };
+
         if(t == '(')
         {
-            tokens.push_back(Token{OPEN_PAREN, std::string(1, t), line, column}); //brace initialization in case you forget
+            tokens.push_back(Token{OPEN_PAREN, src.substr(start, 1), line, column}); //brace initialization in case you forget
             advance();
         }
         else if(t == ')')
         {
-            tokens.push_back(Token{CLOSE_PAREN, std::string(1, t), line, column});
+            tokens.push_back(Token{CLOSE_PAREN, src.substr(start, 1), line, column});
             advance();
         }
         else if(t == '{')
         {
-            tokens.push_back(Token{OPEN_BRACE, std::string(1, t), line, column});
+            tokens.push_back(Token{OPEN_BRACE, src.substr(start, 1), line, column});
             advance();
         }
         else if(t == '}')
         {
-            tokens.push_back(Token{CLOSE_BRACE, std::string(1, t), line, column});
+            tokens.push_back(Token{CLOSE_BRACE, src.substr(start, 1), line, column});
             advance();
         }
         else if(t == ',')
         {
-            tokens.push_back(Token{COMMA, std::string(1, t), line, column});
+            tokens.push_back(Token{COMMA, src.substr(start, 1), line, column});
             advance();
         }
         else if(t == '.')
         {
-            tokens.push_back(Token{DOT, std::string(1, t), line, column});
+            tokens.push_back(Token{DOT, src.substr(start, 1), line, column});
             advance();
         }
         else if(t == ';')
         {
-            tokens.push_back(Token{SEMICOLON, std::string(1, t), line, column});
+            tokens.push_back(Token{SEMICOLON, src.substr(start, 1), line, column});
             advance();
         }
         else if(t == '+')
         {
-            std::string token = std::string(1, t);
             advance();
-            bool match = matchOn('+');
-            if(match) {
-                token += '+';
-                tokens.push_back(Token{PLUS_PLUS, token, line, column - 1});
-            } else {
-                match = matchOn('=');
-                if(match) {
-                    token += '=';
-                    tokens.push_back(Token{PLUS_EQUAL, token, line, column - 1});
-                } else {
-                    tokens.push_back(Token{PLUS, token, line, column - 1});
-                }
-            }
+            TokenType type = matchOn('+') ? PLUS_PLUS : matchOn('=') ? PLUS_EQUAL : PLUS;
+            tokens.push_back(Token{type, lexeme(), line, column - 1});
         }
         else if(t == '-')
         {
-            std::string token = std::string(1, t);
             advance();
-            bool match = matchOn('-');
-            if(match) {
-                token += '-';
-                tokens.push_back(Token{MINUS_MINUS, token, line, column - 1});
-            } else {
-                match = matchOn('=');
-                if(match) {
-                    token += '=';
-                    tokens.push_back(Token{MINUS_EQUAL, token, line, column - 1});
-                } else {
-                    tokens.push_back(Token{MINUS, token, line, column - 1});
-                }
-            }
+            TokenType type = matchOn('-') ? MINUS_MINUS : matchOn('=') ? MINUS_EQUAL : MINUS;
+            tokens.push_back(Token{type, lexeme(), line, column - 1});
         }
         else if(t == '*')
         {
-            std::string token = std::string(1, t);
             advance();
-            bool match = matchOn('=');
-            if(match) {
-                token += '=';
-                tokens.push_back(Token{STAR_EQUAL, token, line, column - 1});
-            } else {
-                tokens.push_back(Token{STAR, token, line, column - 1});
-            }
+            TokenType type = matchOn('=') ? STAR_EQUAL : STAR;
+            tokens.push_back(Token{type, lexeme(), line, column - 1});
         }
         else if(t == '%')
         {
-            std::string token = std::string(1, t);
             advance();
-            bool match = matchOn('=');
-            if(match) {
-                token += '=';
-                tokens.push_back(Token{PERCENT_EQUAL, token, line, column - 1});
-            } else {
-                tokens.push_back(Token{PERCENT, token, line, column - 1});
-            }
+            TokenType type = matchOn('=') ? PERCENT_EQUAL : PERCENT;
+            tokens.push_back(Token{type, lexeme(), line, column - 1});
         }
         else if(t == '~')
         {
-            tokens.push_back(Token{BIN_NOT, std::string(1, t), line, column - 1});
+            tokens.push_back(Token{BIN_NOT, src.substr(start, 1), line, column - 1});
             advance();
         }
         else if(t == '=')
         {
-            std::string token = std::string(1, t);
+            int startColumn = column;
             advance();
-            bool match = matchOn('=');
-            token += match ? "=" : "";
-            tokens.push_back(Token{match ? DOUBLE_EQUAL : EQUAL, token, line, column - static_cast<int>(token.length())});
+            TokenType type = matchOn('=') ? DOUBLE_EQUAL : EQUAL;
+            tokens.push_back(Token{type, lexeme(), line, startColumn});
         }
         else if(t == '!')
         {
-            std::string token = std::string(1, t);
+            int startColumn = column;
             advance();
-            bool match = matchOn('=');
-            token += match ? "=" : "";
-            tokens.push_back(Token{match ? BANG_EQUAL : BANG, token, line, column - static_cast<int>(token.length())});
+            TokenType type = matchOn('=') ? BANG_EQUAL : BANG;
+            tokens.push_back(Token{type, lexeme(), line, startColumn});
         }
         else if(t == '<')
         {
-            std::string token = std::string(1, t);
             advance();
+            TokenType type = LESS;
             if(matchOn('='))
             {
-                tokens.push_back(Token{LESS_EQUAL, "<=", line, column - 1});
+                type = LESS_EQUAL;
             }
             else if(matchOn('<'))
             {
-                bool equalMatch = matchOn('=');
-                if(equalMatch) {
-                    tokens.push_back(Token{BIN_SLEFT_EQUAL, "<<=", line, column - 1});
-                } else {
-                    tokens.push_back(Token{BIN_SLEFT, "<<", line, column - 1});
-                }
-            }
-            else
-            {
-                tokens.push_back(Token{LESS, token, line, column - static_cast<int>(token.length())});
+                type = matchOn('=') ? BIN_SLEFT_EQUAL : BIN_SLEFT;
             }
-
+            tokens.push_back(Token{type, lexeme(), line, column - 1});
         }
         else if(t == '>')
         {
-            std::string token = std::string(1, t);
             advance();
+            TokenType type = GREATER;
             if(matchOn('='))
             {
-                tokens.push_back(Token{GREATER_EQUAL, ">=", line, column - 1});
+                type = GREATER_EQUAL;
             }
             else if(matchOn('>'))
             {
-                bool equalMatch = matchOn('=');
-                if(equalMatch) {
-                    tokens.push_back(Token{BIN_SRIGHT_EQUAL, ">>=", line, column - 1});
-                } else {
-                    tokens.push_back(Token{BIN_SRIGHT, ">>", line, column - 1});
-                }
-            }
-            else
-            {
-                tokens.push_back(Token{GREATER, token, line, column - static_cast<int>(token.length())});
+                type = matchOn('=') ? BIN_SRIGHT_EQUAL : BIN_SRIGHT;
             }
+            tokens.push_back(Token{type, lexeme(), line, column - 1});
         }
         else if(t == '&')
         {
-            std::string token = std::string(1, t);
             advance();
-            bool match = matchOn('&');
-            if(match) {
-                token += '&';
-                tokens.push_back(Token{AND, token, line, column - 1});
-            } else {
-                bool equalMatch = matchOn('=');
-                if(equalMatch) {
-                    token += '=';
-                    tokens.push_back(Token{BIN_AND_EQUAL, token, line, column - 1});
-                } else {
-                    tokens.push_back(Token{BIN_AND, token, line, column - 1});
-                }
-            }
+            TokenType type = matchOn('&') ? AND : matchOn('=') ? BIN_AND_EQUAL : BIN_AND;
+            tokens.push_back(Token{type, lexeme(), line, column - 1});
         }
         else if(t == '|')
         {
-            std::string token = std::string(1, t);
             advance();
-            bool match = matchOn('|');
-            if(match) {
-                token += '|';
-                tokens.push_back(Token{OR, token, line, column - 1});
-            } else {
-                bool equalMatch = matchOn('=');
-                if(equalMatch) {
-                    token += '=';
-                    tokens.push_back(Token{BIN_OR_EQUAL, token, line, column - 1});
-                } else {
-                    tokens.push_back(Token{BIN_OR, token, line, column - 1});
-                }
-            }
+            TokenType type = matchOn('|') ? OR : matchOn('=') ? BIN_OR_EQUAL : BIN_OR;
+            tokens.push_back(Token{type, lexeme(), line, column - 1});
         }
         else if(t == '^')
         {
-            std::string token = std::string(1, t);
             advance();
-            bool match = matchOn('=');
-            if(match) {
-                tokens.push_back(Token{BIN_XOR_EQUAL, "^=", line, column - 1});
-            } else {
-                tokens.push_back(Token{BIN_XOR, "^", line, column - 1});
-            }
+            TokenType type = matchOn('=') ? BIN_XOR_EQUAL : BIN_XOR;
+            tokens.push_back(Token{type, lexeme(), line, column - 1});
         }
         else if(t == '/')
         {
-            std::string token = std::string(1, t);
             advance();
-            bool match = matchOn('/');
-            if(match)
+            if(matchOn('/'))
             {
-                while(!src.empty() && src[0] != '\n')
+                while(!isAtEnd() && peek() != '\n')
                 {
                     advance();
                 }
             }
-            else
+            else if(matchOn('*'))
             {
-                bool starMatch = matchOn('*');
-                if(starMatch)
+                // Multi-line comment /* ... */
+                while(!isAtEnd())
                 {
-                    // Multi-line comment /* ... */
-                    while(!src.empty())
+                    if(peek() == '*' && peekNext() == '/')
                     {
-                        if(src[0] == '*' && !src.empty() && src.size() > 1 && src[1] == '/')
-                        {
-                            advance(2);  // Skip */
-                            break;
-                        }
-                        advance();
-                    }
-                }
-                else
-                {
-                    bool equalMatch = matchOn('=');
-                    if(equalMatch) {
-                        tokens.push_back(Token{SLASH_EQUAL, "/=", line, column - 1});
-                    } else {
-                        tokens.push_back(Token{SLASH, "/", line, column - 1});
+                        advance(2);  // Skip */
+                        break;
                     }
+                    advance();
                 }
             }
+            else
+            {
+                TokenType type = matchOn('=') ? SLASH_EQUAL : SLASH;
+                tokens.push_back(Token{type, lexeme(), line, column - 1});
+            }
         }
         else if(t == '"')
         {
-            bool last_was_escape = false;
-            std::string str;
             int startColumn = column;
+            bool hasEscape = false;
             advance();
 
-            while(!src.empty())
+            while(!isAtEnd() && peek() != '"')
             {
-                std::string next_c =  std::string(1, src[0]);
-                if(next_c == "\"") break;
-                if(next_c == "\\")
+                if(peek() == '\\')
                 {
+                    hasEscape = true;
                     advance();
-                    next_c = "\\" + std::string(1, src[0]);
+                    if(isAtEnd()) break;
                 }
-
-                str += next_c;
                 advance();
             }
 
-            if(src.empty())
+            if(isAtEnd())
             {
                 throw std::runtime_error("LEXER: Unterminated string at line: " + std::to_string(this->line));
             }
-            else if(src[0] == '"')
-            {
-
-                advance();
 
+            std::string_view body = src.substr(start + 1, current - start - 1);
+            advance();
 
-                std::string escaped_str = parseEscapeCharacters(str);
-                tokens.push_back(Token{STRING, escaped_str, line, startColumn});
+            // Strings without escapes view the source directly
+            if(hasEscape)
+            {
+                literals.push_back(parseEscapeCharacters(body));
+                body = literals.back();
             }
-            
-
+            tokens.push_back(Token{STRING, body, line, startColumn});
         }
         else if(t == '\n')
         {
@@ -307,106 +214,87 @@ std::vector<Token> Lexer::Tokenize(std::string source){
         {
             bool isNotation = false;
             bool notationInvalidated = false;
-            char notationChar;
+            char notationChar = '\0';
             //Multi char tokens
             if(std::isdigit(t))
             {
-                std::string num;
                 int startColumn = column;
 
-                if(src[0] != '0') notationInvalidated = true;
+                if(t != '0') notationInvalidated = true;
 
-                while(!src.empty())
+                while(!isAtEnd() && std::isdigit(peek()))
                 {
-                    if(std::isdigit(src[0]))
-                    {
-                        if(src[0] == '0' && !notationInvalidated)
-                        {
-                            if(peekNext() == 'b' || peekNext() == 'x') {
-                                num += "0";
-                                num += peekNext();
-                                notationChar = peekNext();
-                                advance(2);
-                                isNotation = true;
-                                break;
-                            }
-                        }
-
-                        num += src[0];
-                        advance();
-
-                    }
-                    else
+                    if(peek() == '0' && !notationInvalidated && (peekNext() == 'b' || peekNext() == 'x'))
                     {
+                        notationChar = peekNext();
+                        advance(2);
+                        isNotation = true;
                         break;
                     }
-
+                    advance();
                 }
-                if(!isNotation) {
-                    if (!src.empty() && src[0] == '.') {
+
+                if(!isNotation)
+                {
+                    if(peek() == '.')
+                    {
                         advance();
-                        if (!src.empty() && std::isdigit(src[0])) {
-                            num += '.';
-                            while (!src.empty() && std::isdigit(src[0])) {
-                                num += src[0];
+                        if(!isAtEnd() && std::isdigit(peek()))
+                        {
+                            while(!isAtEnd() && std::isdigit(peek()))
+                            {
                                 advance();
                             }
-                        } else {
+                        }
+                        else
+                        {
                             throw std::runtime_error("LEXER: malformed number at: " + std::to_string(this->line));
                         }
-
                     }
                 }
-                else
+                else if(isAtEnd())
                 {
-                    if(!src.empty() && (src[0]))
+                    throw std::runtime_error("LEXER: malformed notation at: " + std::to_string(this->line));
+                }
+                else if(notationChar == 'b')
+                {
+                    while(peek() == '0' || peek() == '1')
                     {
-                        if(notationChar == 'b') {
-                            while (!src.empty() && (src[0] == '0' || src[0] == '1')) {
-                                num += src[0];
-                                advance();
-                            }
-                        }
-                        else if(notationChar == 'x')
-                        {
-                            while (!src.empty() && std::isxdigit(src[0])) {
-
-                                num += src[0];
-                                advance();
-                            }
-                        }
+                        advance();
                     }
-                    else
+                }
+                else
+                {
+                    while(!isAtEnd() && std::isxdigit(peek()))
                     {
-                        throw std::runtime_error("LEXER: malformed notation at: " + std::to_string(this->line));
+                        advance();
                     }
                 }
 
-                tokens.push_back(Token{NUMBER, num, line, startColumn});
+                tokens.push_back(Token{NUMBER, lexeme(), line, startColumn});
             }
             else if(std::isalpha(t))
             {
-                std::string ident;
                 int startColumn = column;
-                while(!src.empty() && (std::isalpha(src[0]) || std::isdigit(src[0]) || src[0] == '_'))
+                while(!isAtEnd() && (std::isalnum(peek()) || peek() == '_'))
                 {
-                    ident += src[0];
                     advance();
                 }
 
-                if(KEYWORDS.find(ident) != KEYWORDS.end()) //identifier is a keyword
+                std::string_view ident = lexeme();
+                auto keyword = KEYWORDS.find(ident);
+                if(keyword != KEYWORDS.end()) //identifier is a keyword
                 {
-                    tokens.push_back(Token{KEYWORDS.at(ident), ident, line, startColumn});
+                    tokens.push_back(Token{keyword->second, ident, line, startColumn});
                 }
                 else
                 {
-                    tokens.push_back(Token{IDENTIFIER, ident, line, startColumn});
+                    tokens.push_back(Token{IDENTIFIER, ident, line, startColumn, SymbolTable::intern(ident)});
                 }
-
             }
             else if(t == ' ' || t == '\t')
             {
-                    advance();
+                advance();
             }
             else
             {
@@ -416,62 +304,47 @@ std::vector<Token> Lexer::Tokenize(std::string source){
                 }
                 throw std::runtime_error("LEXER: Unknown Token: '" + std::string(1, t) + "'");
             }
-
-           
         }
-        
     }
-    tokens.push_back({END_OF_FILE, "eof", line});
+    tokens.push_back({END_OF_FILE, "eof", line, 0});
     return tokens;
 }
 
 bool Lexer::matchOn(char expected)
 {
-    if(src.empty()) return false;
-    if(src[0] != expected) return false;
+    if(isAtEnd()) return false;
+    if(src[current] != expected) return false;
     advance();
     return true;
 }
 
 void Lexer::advance(int by)
 {
-    for (int i = 0; i < by; ++i) {
-        if (!src.empty()) {
-            char c = src[0];
-            src.erase(src.begin());
-            
-            // Update column and line counters
-            if (c == '\n') {
+    for (int i = 0; i < by && !isAtEnd(); ++i) {
+        char c = src[current++];
+
+        // Update column and line counters
+        if (c == '\n') {
+            line++;
+            column = 1;
+        } else if (c == '\r') {
+            // Handle \r\n sequence
+            if (!isAtEnd() && src[current] == '\n') {
+                current++;
                 line++;
                 column = 1;
-            } else if (c == '\r') {
-                // Handle \r\n sequence
-                if (!src.empty() && src[0] == '\n') {
-                    src.erase(src.begin());
-                    line++;
-                    column = 1;
-                } else {
-                    column++;
-                }
             } else {
                 column++;
             }
+        } else {
+            column++;
         }
     }
 }
 
-char Lexer::peekNext()
-{
-    if(src.size() > 1)
-    {
-        return src[1];
-    }
-
-    return '\0';
-}
-
-std::string Lexer::parseEscapeCharacters(const std::string& input) {
+std::string Lexer::parseEscapeCharacters(std::string_view input) {
     std::string output;
+    output.reserve(input.size());
     bool escapeMode = false;
 
     for (char c : input) {
@@ -502,5 +375,3 @@ std::string Lexer::parseEscapeCharacters(const std::string& input) {
 
     return output;
 }
-
-
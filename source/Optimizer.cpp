@@ -0,0 +1,235 @@
+#include "../headers/Optimizer.h"
+#include "../headers/Numeric.h"
+
+void Optimizer::optimize(std::vector<Stmt*>& statements) {
+    optimizeBody(statements);
+}
+
+Expr* Optimizer::fold(Expr* expression) {
+    if (expression == nullptr) return nullptr;
+    replacement = nullptr;
+    visitExpr(*this, *expression);
+    Expr* result = replacement ? replacement : expression;
+    replacement = nullptr;
+    return result;
+}
+
+Stmt* Optimizer::optimizeStatement(Stmt* statement) {
+    statementReplacement = nullptr;
+    removeStatement = false;
+    visitStmt(*this, *statement, nullptr);
+    Stmt* result = removeStatement ? nullptr : (statementReplacement ? statementReplacement : statement);
+    statementReplacement = nullptr;
+    removeStatement = false;
+    return result;
+}
+
+void Optimizer::optimizeBody(std::vector<Stmt*>& statements) {
+    std::vector<Stmt*> kept;
+    kept.reserve(statements.size());
+    bool unreachable = false;
+
+    for (Stmt* statement : statements) {
+        if (unreachable) {
+            // Declarations after a return never run, but they stay so that
+            // closures above them still resolve the name to the same local
+            if (nodeCast<VarStmt>(statement) || nodeCast<FunctionStmt>(statement)) {
+                kept.push_back(statement);
+            }
+            continue;
+        }
+
+        Stmt* optimized = optimizeStatement(statement);
+        if (optimized == nullptr) continue;
+        kept.push_back(optimized);
+
+        // A return at the top level does not stop the script in the tree-walker,
+        // so only function bodies have unreachable code
+        if (functionDepth > 0 && nodeCast<ReturnStmt>(optimized)) {
+            unreachable = true;
+        }
+    }
+
+    statements = std::move(kept);
+}
+
+// Mirrors Interpreter::isTruthy for the values a literal can hold
+bool Optimizer::isTruthy(const Value& value) {
+    if (value.isBoolean()) return value.asBoolean();
+    if (value.isNone()) return false;
+    if (value.isNumber()) return value.asNumber() != 0;
+    if (value.isString()) return !value.asString().empty();
+    return true;
+}
+
+// Folds only the operand/operator combinations that Interpreter::binaryOperation
+// evaluates without error, computing the result the same way
+bool Optimizer::foldBinary(const Token& oper, const Value& left, const Value& right, Value& result) {
+    if (left.isNumber() && right.isNumber()) {
+        return numberBinary(oper.type, left, right, result) == NumericResult::Ok;
+    }
+
+    if (left.isString() && right.isString()) {
+        switch (oper.type) {
+            case PLUS: result = Value::intern(left.asString() + right.asString()); return true;
+            case DOUBLE_EQUAL: result = Value(left.equals(right)); return true;
+            case BANG_EQUAL: result = Value(!left.equals(right)); return true;
+            default: return false;
+        }
+    }
+
+    // String concatenation with a number, boolean or none formats the other side.
+    // The result is a literal like any other, so it is interned.
+    if (oper.type == PLUS && (left.isString() || right.isString())) {
+        const Value& other = left.isString() ? right : left;
+        if (other.isNumber() || other.isBoolean() || other.isNone()) {
+            result = Value::intern((left + right).asString());
+            return true;
+        }
+        return false;
+    }
+
+    if (left.isBoolean() && right.isBoolean()) {
+        switch (oper.type) {
+            case DOUBLE_EQUAL: result = Value(left.asBoolean() == right.asBoolean()); return true;
+            case BANG_EQUAL: result = Value(left.asBoolean() != right.asBoolean()); return true;
+            default: return false;
+        }
+    }
+
+    return false;
+}
+
+bool Optimizer::foldUnary(const Token& oper, const Value& right, Value& result) {
+    switch (oper.type) {
+        case MINUS:
+        case BIN_NOT:
+            return right.isNumber() && numberUnary(oper.type, right, result);
+        case BANG:
+            result = Value(!isTruthy(right));
+            return true;
+        default:
+            return false;
+    }
+}
+
+Value Optimizer::visitBinaryExpr(BinaryExpr& expression) {
+    expression.left = fold(expression.left);
+    expression.right = fold(expression.right);
+
+    auto* left = nodeCast<LiteralExpr>(expression.left);
+    auto* right = nodeCast<LiteralExpr>(expression.right);
+    Value result;
+    if (left && right && foldBinary(expression.oper, left->value, right->value, result)) {
+        replacement = arena.make<LiteralExpr>(std::move(result));
+    }
+    return NONE_VALUE;
+}
+
+Value Optimizer::visitLogicalExpr(LogicalExpr& expression) {
+    expression.left = fold(expression.left);
+    expression.right = fold(expression.right);
+
+    // A literal left operand decides at compile time which operand is the result
+    if (auto* left = nodeCast<LiteralExpr>(expression.left)) {
+        bool decided = expression.oper.type == OR ? isTruthy(left->value) : !isTruthy(left->value);
+        replacement = decided ? expression.left : expression.right;
+        return NONE_VALUE;
+    }
+    expression.link();
+    return NONE_VALUE;
+}
+
+Value Optimizer::visitUnaryExpr(UnaryExpr& expression) {
+    expression.right = fold(expression.right);
+
+    auto* right = nodeCast<LiteralExpr>(expression.right);
+    Value result;
+    if (right && foldUnary(expression.oper, right->value, result)) {
+        replacement = arena.make<LiteralExpr>(std::move(result));
+    }
+    return NONE_VALUE;
+}
+
+Value Optimizer::visitGroupingExpr(GroupingExpr& expression) {
+    expression.expression = fold(expression.expression);
+    if (nodeCast<LiteralExpr>(expression.expression)) {
+        replacement = expression.expression;
+    }
+    return NONE_VALUE;
+}
+
+Value Optimizer::visitAssignExpr(AssignExpr& expression) {
+    expression.value = fold(expression.value);
+    return NONE_VALUE;
+}
+
+Value Optimizer::visitCallExpr(CallExpr& expression) {
+    expression.callee = fold(expression.callee);
+    for (Expr*& argument : expression.arguments) {
+        argument = fold(argument);
+    }
+    return NONE_VALUE;
+}
+
+Value Optimizer::visitFunctionExpr(FunctionExpr& expression) {
+    functionDepth++;
+    optimizeBody(expression.body);
+    functionDepth--;
+    return NONE_VALUE;
+}
+
+Value Optimizer::visitIncrementExpr(IncrementExpr& expression) {
+    return NONE_VALUE;
+}
+
+Value Optimizer::visitLiteralExpr(LiteralExpr& expression) {
+    return NONE_VALUE;
+}
+
+Value Optimizer::visitVarExpr(VarExpr& expression) {
+    return NONE_VALUE;
+}
+
+void Optimizer::visitBlockStmt(BlockStmt& statement, ExecutionContext* context) {
+    optimizeBody(statement.statements);
+}
+
+void Optimizer::visitExpressionStmt(ExpressionStmt& statement, ExecutionContext* context) {
+    statement.expression = fold(statement.expression);
+}
+
+void Optimizer::visitVarStmt(VarStmt& statement, ExecutionContext* context) {
+    statement.initializer = fold(statement.initializer);
+}
+
+void Optimizer::visitFunctionStmt(FunctionStmt& statement, ExecutionContext* context) {
+    functionDepth++;
+    optimizeBody(statement.body);
+    functionDepth--;
+}
+
+void Optimizer::visitReturnStmt(ReturnStmt& statement, ExecutionContext* context) {
+    statement.value = fold(statement.value);
+}
+
+void Optimizer::visitIfStmt(IfStmt& statement, ExecutionContext* context) {
+    statement.setCondition(fold(statement.condition));
+
+    if (auto* condition = nodeCast<LiteralExpr>(statement.condition)) {
+        Stmt* taken = isTruthy(condition->value) ? statement.thenBranch : statement.elseBranch;
+        Stmt* optimized = taken ? optimizeStatement(taken) : nullptr;
+        if (optimized) {
+            statementReplacement = optimized;
+        } else {
+            removeStatement = true;
+        }
+        return;
+    }
+
+    Stmt* thenBranch = optimizeStatement(statement.thenBranch);
+    statement.thenBranch = thenBranch ? thenBranch : arena.make<BlockStmt>(std::vector<Stmt*>());
+    if (statement.elseBranch != nullptr) {
+        statement.elseBranch = optimizeStatement(statement.elseBranch);
+    }
+}
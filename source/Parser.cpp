@@ -2,116 +2,147 @@
 // Created by Bobby Lucero on 5/26/23.
 //
 #include "../headers/Parser.h"
+#include "../headers/helperFunctions/HelperFunctions.h"
 #include <stdexcept>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+
+// Decode a number literal once at parse time: 0b binary, 0x hex or decimal.
+// Integral literals that fit in int64 become integers, everything else a double.
+static Value numberLiteral(std::string_view lexeme)
+{
+    std::string text(lexeme);
+    if(text.size() > 1 && text[1] == 'b')
+    {
+        u_long bits = binaryStringToLong(text);
+        if(bits <= static_cast<u_long>(INT64_MAX))
+        {
+            return Value::integer(static_cast<int64_t>(bits));
+        }
+        return Value(static_cast<double>(bits));
+    }
+    if(text.find('.') == std::string::npos)
+    {
+        bool hex = text.size() > 1 && text[1] == 'x';
+        errno = 0;
+        long long integer = std::strtoll(text.c_str(), nullptr, hex ? 16 : 10);
+        if(errno != ERANGE)
+        {
+            return Value::integer(integer);
+        }
+    }
+    return Value(std::stod(text));
+}
 
 
 //              Precedence
 // to all the morons on facebook who don't know what pemdas is, fuck you
 ///////////////////////////////////////////
 
-sptr(Expr) Parser::expression()
+Expr* Parser::expression()
 {
     return assignment();
 }
 
-sptr(Expr) Parser::logical_or()
+Expr* Parser::logical_or()
 {
-    sptr(Expr) expr = logical_and();
+    Expr* expr = logical_and();
 
     while(match({OR}))
     {
         Token op = previous();
-        sptr(Expr) right = logical_and();
-        expr = msptr(BinaryExpr)(expr, op, right);
+        Expr* right = logical_and();
+        expr = make<LogicalExpr>(expr, op, right);
     }
 
     return expr;
 }
 
-sptr(Expr) Parser::logical_and()
+Expr* Parser::logical_and()
 {
-    sptr(Expr) expr = equality();
+    Expr* expr = equality();
 
     while(match({AND}))
     {
         Token op = previous();
-        sptr(Expr) right = equality();
-        expr = msptr(BinaryExpr)(expr, op, right);
+        Expr* right = equality();
+        expr = make<LogicalExpr>(expr, op, right);
     }
 
     return expr;
 }
 
 // bitwise_or now calls comparison (not bitwise_xor)
-sptr(Expr) Parser::bitwise_or()
+Expr* Parser::bitwise_or()
 {
-    sptr(Expr) expr = bitwise_xor();
+    Expr* expr = bitwise_xor();
 
     while(match({BIN_OR}))
     {
         Token op = previous();
-        sptr(Expr) right = bitwise_xor();
-        expr = msptr(BinaryExpr)(expr, op, right);
+        Expr* right = bitwise_xor();
+        expr = make<BinaryExpr>(expr, op, right);
     }
 
     return expr;
 }
 
-sptr(Expr) Parser::bitwise_xor()
+Expr* Parser::bitwise_xor()
 {
-    sptr(Expr) expr = bitwise_and();
+    Expr* expr = bitwise_and();
 
     while(match({BIN_XOR}))
     {
         Token op = previous();
-        sptr(Expr) right = bitwise_and();
-        expr = msptr(BinaryExpr)(expr, op, right);
+        Expr* right = bitwise_and();
+        expr = make<BinaryExpr>(expr, op, right);
     }
 
     return expr;
 }
 
-sptr(Expr) Parser::bitwise_and()
+Expr* Parser::bitwise_and()
 {
-    sptr(Expr) expr = shift();
+    Expr* expr = shift();
 
     while(match({BIN_AND}))
     {
         Token op = previous();
-        sptr(Expr) right = shift();
-        expr = msptr(BinaryExpr)(expr, op, right);
+        Expr* right = shift();
+        expr = make<BinaryExpr>(expr, op, right);
     }
 
     return expr;
 }
 
-sptr(Expr) Parser::shift()
+Expr* Parser::shift()
 {
-    sptr(Expr) expr = term();
+    Expr* expr = term();
 
     while(match({BIN_SLEFT, BIN_SRIGHT}))
     {
         Token op = previous();
-        sptr(Expr) right = term();
-        expr = msptr(BinaryExpr)(expr, op, right);
+        Expr* right = term();
+        expr = make<BinaryExpr>(expr, op, right);
     }
 
     return expr;
 }
 
-sptr(Expr) Parser::assignment()
+Expr* Parser::assignment()
 {
-    sptr(Expr) expr = increment();
+    Expr* expr = increment();
 
     if(match({EQUAL, PLUS_EQUAL, MINUS_EQUAL, STAR_EQUAL, SLASH_EQUAL, PERCENT_EQUAL,
               BIN_AND_EQUAL, BIN_OR_EQUAL, BIN_XOR_EQUAL, BIN_SLEFT_EQUAL, BIN_SRIGHT_EQUAL}))
     {
         Token op = previous();
-        sptr(Expr) value = assignment();
-        if(std::dynamic_pointer_cast<VarExpr>(expr))
+        Expr* value = assignment();
+        if(nodeCast<VarExpr>(expr))
         {
-            Token name = std::dynamic_pointer_cast<VarExpr>(expr)->name;
-            return msptr(AssignExpr)(name, op, value);
+            Token name = nodeCast<VarExpr>(expr)->name;
+            return make<AssignExpr>(name, op, value);
         }
         
         if (errorReporter) {
@@ -124,103 +155,103 @@ sptr(Expr) Parser::assignment()
     return expr;
 }
 
-sptr(Expr) Parser::increment()
+Expr* Parser::increment()
 {
     return logical_or();
 }
 
-sptr(Expr) Parser::equality()
+Expr* Parser::equality()
 {
-    sptr(Expr) expr = comparison();
+    Expr* expr = comparison();
 
     while(match({BANG_EQUAL, DOUBLE_EQUAL}))
     {
         Token op = previous();
-        sptr(Expr) right = comparison();
-        expr = msptr(BinaryExpr)(expr, op, right);
+        Expr* right = comparison();
+        expr = make<BinaryExpr>(expr, op, right);
     }
 
     return expr;
 }
 
-sptr(Expr) Parser::comparison()
+Expr* Parser::comparison()
 {
-    sptr(Expr) expr = bitwise_or();
+    Expr* expr = bitwise_or();
 
     while(match({GREATER, GREATER_EQUAL, LESS, LESS_EQUAL}))
     {
         Token op = previous();
-        sptr(Expr) right = bitwise_or();
-        expr = msptr(BinaryExpr)(expr, op, right);
+        Expr* right = bitwise_or();
+        expr = make<BinaryExpr>(expr, op, right);
     }
 
     return expr;
 }
 
-sptr(Expr) Parser::term()
+Expr* Parser::term()
 {
-    sptr(Expr) expr = factor();
+    Expr* expr = factor();
 
     while(match({MINUS, PLUS}))
     {
         Token op = previous();
-        sptr(Expr) right = factor();
-        expr = msptr(BinaryExpr)(expr, op, right);
+        Expr* right = factor();
+        expr = make<BinaryExpr>(expr, op, right);
     }
 
     return expr;
 }
 
-sptr(Expr) Parser::factor()
+Expr* Parser::factor()
 {
-    sptr(Expr) expr = unary();
+    Expr* expr = unary();
 
     while(match({SLASH, STAR, PERCENT}))
     {
         Token op = previous();
-        sptr(Expr) right = unary();
-        expr = msptr(BinaryExpr)(expr, op, right);
+        Expr* right = unary();
+        expr = make<BinaryExpr>(expr, op, right);
     }
 
     return expr;
 }
 
-sptr(Expr) Parser::unary()
+Expr* Parser::unary()
 {
     if(match({BANG, MINUS, BIN_NOT, PLUS_PLUS, MINUS_MINUS}))
     {
         Token op = previous();
-        sptr(Expr) right = unary();
+        Expr* right = unary();
         
         // Handle prefix increment/decrement
         if (op.type == PLUS_PLUS || op.type == MINUS_MINUS) {
             // Ensure the operand is a variable
-            if (!std::dynamic_pointer_cast<VarExpr>(right)) {
+            if (!nodeCast<VarExpr>(right)) {
                 if (errorReporter) {
                     errorReporter->reportError(op.line, op.column, "Parse Error", 
                         "Prefix increment/decrement can only be applied to variables", "");
                 }
                 throw std::runtime_error("Prefix increment/decrement can only be applied to variables.");
             }
-            return msptr(IncrementExpr)(right, op, true);  // true = prefix
+            return make<IncrementExpr>(right, op, true);  // true = prefix
         }
         
-        return msptr(UnaryExpr)(op, right);
+        return make<UnaryExpr>(op, right);
     }
 
     return postfix();
 }
 
-sptr(Expr) Parser::postfix()
+Expr* Parser::postfix()
 {
-    sptr(Expr) expr = primary();
+    Expr* expr = primary();
     
     // Check for postfix increment/decrement
     if (match({PLUS_PLUS, MINUS_MINUS})) {
         Token oper = previous();
         
         // Ensure the expression is a variable
-        if (!std::dynamic_pointer_cast<VarExpr>(expr)) {
+        if (!nodeCast<VarExpr>(expr)) {
             if (errorReporter) {
                 errorReporter->reportError(oper.line, oper.column, "Parse Error", 
                     "Postfix increment/decrement can only be applied to variables", "");
@@ -228,36 +259,36 @@ sptr(Expr) Parser::postfix()
             throw std::runtime_error("Postfix increment/decrement can only be applied to variables.");
         }
         
-        return msptr(IncrementExpr)(expr, oper, false);  // false = postfix
+        return make<IncrementExpr>(expr, oper, false);  // false = postfix
     }
     
     return expr;
 }
 
-sptr(Expr) Parser::primary()
+Expr* Parser::primary()
 {
-    if(match({FALSE})) return msptr(LiteralExpr)("false", false, false, true);
-    if(match({TRUE})) return msptr(LiteralExpr)("true", false, false, true);
-    if(match({NONE})) return msptr(LiteralExpr)("none", false, true, false);
+    if(match({FALSE})) return make<LiteralExpr>(FALSE_VALUE);
+    if(match({TRUE})) return make<LiteralExpr>(TRUE_VALUE);
+    if(match({NONE})) return make<LiteralExpr>(NONE_VALUE);
 
-    if(match({NUMBER})) return msptr(LiteralExpr)(previous().lexeme, true, false, false);
-    if(match({STRING})) return msptr(LiteralExpr)(previous().lexeme, false, false, false);
+    if(match({NUMBER})) return make<LiteralExpr>(numberLiteral(previous().lexeme));
+    if(match({STRING})) return make<LiteralExpr>(Value::intern(std::string(previous().lexeme)));
 
     if(match( {IDENTIFIER})) {
         if (check(OPEN_PAREN)) {
-            return finishCall(msptr(VarExpr)(previous()));
+            return finishCall(make<VarExpr>(previous()));
         }
-        return msptr(VarExpr)(previous());
+        return make<VarExpr>(previous());
     }
 
     if(match({OPEN_PAREN}))
     {
-        sptr(Expr) expr = expression();
+        Expr* expr = expression();
         consume(CLOSE_PAREN, "Expected ')' after expression on line " + std::to_string(peek().line));
         if (check(OPEN_PAREN)) {
-            return finishCall(msptr(GroupingExpr)(expr));
+            return finishCall(make<GroupingExpr>(expr));
         }
-        return msptr(GroupingExpr)(expr);
+        return make<GroupingExpr>(expr);
     }
 
     if(match({FUNCTION})) {
@@ -274,9 +305,9 @@ sptr(Expr) Parser::primary()
 ///////////////////////////////////////////
 
 
-std::vector<sptr(Stmt)> Parser::parse() {
+std::vector<Stmt*> Parser::parse() {
 
-        std::vector<sptr(Stmt)> statements;
+        std::vector<Stmt*> statements;
         while(!isAtEnd())
         {
             statements.push_back(declaration());
@@ -286,7 +317,7 @@ std::vector<sptr(Stmt)> Parser::parse() {
 
 }
 
-sptr(Stmt) Parser::declaration()
+Stmt* Parser::declaration()
 {
     try{
         if(match({VAR})) return varDeclaration();
@@ -300,20 +331,20 @@ sptr(Stmt) Parser::declaration()
     }
 }
 
-sptr(Stmt) Parser::varDeclaration()
+Stmt* Parser::varDeclaration()
 {
     Token name = consume(IDENTIFIER, "Expected variable name.");
 
-    sptr(Expr) initializer = msptr(LiteralExpr)("none", false, true, false);
+    Expr* initializer = make<LiteralExpr>(NONE_VALUE);
     if(match({EQUAL}))
     {
         initializer = expression();
     }
     consume(SEMICOLON, "Expected ';' after variable declaration.");
-    return msptr(VarStmt)(name, initializer);
+    return make<VarStmt>(name, initializer);
 }
 
-sptr(Stmt) Parser::functionDeclaration()
+Stmt* Parser::functionDeclaration()
 {
     Token name = consume(IDENTIFIER, "Expected function name.");
     consume(OPEN_PAREN, "Expected '(' after function name.");
@@ -331,15 +362,15 @@ sptr(Stmt) Parser::functionDeclaration()
     // Enter function scope
     enterFunction();
     
-    std::vector<sptr(Stmt)> body = block();
+    std::vector<Stmt*> body = block();
     
     // Exit function scope
     exitFunction();
     
-    return msptr(FunctionStmt)(name, parameters, body);
+    return make<FunctionStmt>(name, parameters, body);
 }
 
-std::shared_ptr<Expr> Parser::functionExpression() {
+Expr* Parser::functionExpression() {
     consume(OPEN_PAREN, "Expect '(' after 'func'.");
     std::vector<Token> parameters;
     if (!check(CLOSE_PAREN)) {
@@ -360,50 +391,50 @@ std::shared_ptr<Expr> Parser::functionExpression() {
     // Enter function scope
     enterFunction();
     
-    std::vector<std::shared_ptr<Stmt>> body = block();
+    std::vector<Stmt*> body = block();
     
     // Exit function scope
     exitFunction();
     
-    return msptr(FunctionExpr)(parameters, body);
+    return make<FunctionExpr>(parameters, body);
 }
 
-sptr(Stmt) Parser::statement()
+Stmt* Parser::statement()
 {
     if(match({RETURN})) return returnStatement();
     if(match({IF})) return ifStatement();
-    if(match({OPEN_BRACE})) return msptr(BlockStmt)(block());
+    if(match({OPEN_BRACE})) return make<BlockStmt>(block());
     return expressionStatement();
 }
 
 
 
-sptr(Stmt) Parser::ifStatement()
+Stmt* Parser::ifStatement()
 {
     consume(OPEN_PAREN, "Expected '(' after 'if'.");
-    sptr(Expr) condition = expression();
+    Expr* condition = expression();
     consume(CLOSE_PAREN, "Expected ')' after if condition.");
     
-    sptr(Stmt) thenBranch = statement();
-    sptr(Stmt) elseBranch = nullptr;
+    Stmt* thenBranch = statement();
+    Stmt* elseBranch = nullptr;
     
     if (match({ELSE})) {
         elseBranch = statement();
     }
     
-    return msptr(IfStmt)(condition, thenBranch, elseBranch);
+    return make<IfStmt>(condition, thenBranch, elseBranch);
 }
 
 // Helper function to detect if an expression is a tail call
-bool Parser::isTailCall(const std::shared_ptr<Expr>& expr) {
+bool Parser::isTailCall(Expr* expr) {
     // Check if this is a direct function call (no operations on the result)
-    if (auto callExpr = std::dynamic_pointer_cast<CallExpr>(expr)) {
+    if (auto callExpr = nodeCast<CallExpr>(expr)) {
         return true;  // Direct function call in return statement
     }
     return false;
 }
 
-sptr(Stmt) Parser::returnStatement()
+Stmt* Parser::returnStatement()
 {
     Token keyword = previous();
     
@@ -416,33 +447,33 @@ sptr(Stmt) Parser::returnStatement()
         throw std::runtime_error("Cannot return from outside a function");
     }
     
-    sptr(Expr) value = msptr(LiteralExpr)("none", false, true, false);
+    Expr* value = make<LiteralExpr>(NONE_VALUE);
     
     if (!check(SEMICOLON)) {
         value = expression();
         
         // Check if this is a tail call and mark it
         if (isTailCall(value)) {
-            if (auto callExpr = std::dynamic_pointer_cast<CallExpr>(value)) {
+            if (auto callExpr = nodeCast<CallExpr>(value)) {
                 callExpr->isTailCall = true;
             }
         }
     }
     
     consume(SEMICOLON, "Expected ';' after return value.");
-    return msptr(ReturnStmt)(keyword, value);
+    return make<ReturnStmt>(keyword, value);
 }
 
-sptr(Stmt) Parser::expressionStatement()
+Stmt* Parser::expressionStatement()
 {
-    sptr(Expr) expr = expression();
+    Expr* expr = expression();
     consume(SEMICOLON, "Expected ';' after expression.");
-    return msptr(ExpressionStmt)(expr);
+    return make<ExpressionStmt>(expr);
 }
 
-std::vector<sptr(Stmt)> Parser::block()
+std::vector<Stmt*> Parser::block()
 {
-    std::vector<sptr(Stmt)> statements;
+    std::vector<Stmt*> statements;
 
     while(!check(CLOSE_BRACE) && !isAtEnd())
     {
@@ -453,8 +484,8 @@ std::vector<sptr(Stmt)> Parser::block()
     return statements;
 }
 
-sptr(Expr) Parser::finishCall(sptr(Expr) callee) {
-    std::vector<sptr(Expr)> arguments;
+Expr* Parser::finishCall(Expr* callee) {
+    std::vector<Expr*> arguments;
     
     // Consume the opening parenthesis
     consume(OPEN_PAREN, "Expected '(' after function name.");
@@ -467,7 +498,7 @@ sptr(Expr) Parser::finishCall(sptr(Expr) callee) {
     }
 
     Token paren = consume(CLOSE_PAREN, "Expected ')' after arguments.");
-    return msptr(CallExpr)(callee, paren, arguments);
+    return make<CallExpr>(callee, paren, arguments);
 }
 
 bool Parser::match(const std::vector<TokenType>& types) {
@@ -524,9 +555,9 @@ Token Parser::consume(TokenType type, const std::string& message) {
         }
         
         errorReporter->reportError(peek().line, errorColumn, "Parse Error", 
-            "Unexpected symbol '" + peek().lexeme + "': " + message, "");
+            "Unexpected symbol '" + std::string(peek().lexeme) + "': " + message, "");
     }
-    throw std::runtime_error("Unexpected symbol '" + peek().lexeme +"': "+ message);
+    throw std::runtime_error("Unexpected symbol '" + std::string(peek().lexeme) + "': "+ message);
 }
 
 void Parser::sync()
@@ -0,0 +1,134 @@
+#include "../headers/Profiler.h"
+#include <algorithm>
+#include <iomanip>
+
+// Name of the root frame that covers top-level script code
+static const char* const SCRIPT_ROOT = "<script>";
+
+Profiler::Profiler() {
+    int root = functionId(SCRIPT_ROOT);
+    nodes.push_back(Node{root, -1, 0, {}});
+    functions[root].calls = 1;
+    functions[root].active = 1;
+    stack.push_back(Frame{0, Clock::now(), 0});
+}
+
+int Profiler::functionId(const std::string& name) {
+    auto it = functionIds.find(name);
+    if (it != functionIds.end()) {
+        return it->second;
+    }
+    int id = static_cast<int>(functions.size());
+    functions.push_back(FunctionStats{name});
+    functionIds.emplace(name, id);
+    return id;
+}
+
+void Profiler::enter(const std::string& name) {
+    int id = functionId(name);
+    int parent = stack.back().node;
+
+    int node;
+    auto it = nodes[parent].children.find(id);
+    if (it != nodes[parent].children.end()) {
+        node = it->second;
+    } else {
+        node = static_cast<int>(nodes.size());
+        nodes.push_back(Node{id, parent, 0, {}});
+        nodes[parent].children.emplace(id, node);
+    }
+
+    FunctionStats& stats = functions[id];
+    stats.calls++;
+    stats.active++;
+    stack.push_back(Frame{node, Clock::now(), 0});
+}
+
+void Profiler::exit() {
+    // The script root is only closed by finish()
+    if (stack.size() <= 1) return;
+
+    Frame frame = stack.back();
+    stack.pop_back();
+
+    int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - frame.start).count();
+    int64_t self = elapsed - frame.childNs;
+    Node& node = nodes[frame.node];
+    node.selfNs += self;
+
+    FunctionStats& stats = functions[node.function];
+    stats.selfNs += self;
+    if (--stats.active == 0) {
+        stats.totalNs += elapsed;
+    }
+    stack.back().childNs += elapsed;
+}
+
+void Profiler::unwind() {
+    while (stack.size() > 1) {
+        exit();
+    }
+}
+
+void Profiler::finish() {
+    unwind();
+    if (stack.empty()) return;
+
+    Frame root = stack.back();
+    stack.pop_back();
+    int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - root.start).count();
+    nodes[root.node].selfNs += elapsed - root.childNs;
+    FunctionStats& stats = functions[nodes[root.node].function];
+    stats.selfNs += elapsed - root.childNs;
+    stats.totalNs += elapsed;
+    stats.active = 0;
+}
+
+void Profiler::report(std::ostream& out) {
+    finish();
+
+    std::vector<const FunctionStats*> sorted;
+    for (const FunctionStats& stats : functions) {
+        sorted.push_back(&stats);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const FunctionStats* a, const FunctionStats* b) {
+        return a->selfNs > b->selfNs;
+    });
+
+    int64_t wallNs = functions[0].totalNs > 0 ? functions[0].totalNs : 1;
+    out << std::left << std::setw(24) << "function" << std::right
+        << std::setw(12) << "calls"
+        << std::setw(14) << "self ms"
+        << std::setw(9) << "self %"
+        << std::setw(14) << "total ms" << "\n";
+    out << std::fixed;
+    for (const FunctionStats* stats : sorted) {
+        out << std::left << std::setw(24) << stats->name << std::right
+            << std::setw(12) << stats->calls
+            << std::setw(14) << std::setprecision(3) << stats->selfNs / 1e6
+            << std::setw(8) << std::setprecision(1) << 100.0 * stats->selfNs / wallNs << "%"
+            << std::setw(14) << std::setprecision(3) << stats->totalNs / 1e6 << "\n";
+    }
+    out.flush();
+}
+
+void Profiler::writeCollapsed(std::ostream& out) {
+    finish();
+
+    std::vector<int> path;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        int64_t micros = nodes[i].selfNs / 1000;
+        if (micros <= 0) continue;
+
+        path.clear();
+        for (int node = static_cast<int>(i); node != -1; node = nodes[node].parent) {
+            path.push_back(nodes[node].function);
+        }
+        for (auto it = path.rbegin(); it != path.rend(); ++it) {
+            if (it != path.rbegin()) out << ';';
+            out << functions[*it].name;
+        }
+        out << ' ' << micros << '\n';
+    }
+    out.flush();
+}
@@ -0,0 +1,308 @@
+#include <algorithm>
+#include <climits>
+#include "../headers/Resolver.h"
+
+void Resolver::resolve(const std::vector<Stmt*>& statements) {
+    std::vector<PendingFunction> topLevel;
+    pending = &topLevel;
+    for (const auto& statement : statements) {
+        resolve(statement);
+    }
+    resolvePending(topLevel);
+    pending = nullptr;
+}
+
+void Resolver::resolve(Stmt* statement) {
+    visitStmt(*this, *statement, nullptr);
+}
+
+void Resolver::resolve(Expr* expression) {
+    visitExpr(*this, *expression);
+}
+
+void Resolver::resolvePending(std::vector<PendingFunction>& functions) {
+    for (const PendingFunction& function : functions) {
+        resolveFunction(function);
+    }
+}
+
+void Resolver::resolveFunction(const PendingFunction& function) {
+    std::vector<std::shared_ptr<Scope>> enclosingScopes = scopes;
+    std::vector<int> enclosingVisible = visible;
+    std::vector<FunctionPrototype*> enclosingFunctions = functions;
+    std::vector<PendingFunction>* enclosingPending = pending;
+
+    scopes = function.scopes;
+    visible = function.visible;
+    functions = function.functions;
+    functions.push_back(function.prototype);
+    beginScope(true);
+    for (const Token& param : *function.params) {
+        declare(param);
+    }
+
+    std::vector<PendingFunction> nested;
+    pending = &nested;
+    for (const auto& statement : *function.body) {
+        resolve(statement);
+    }
+    FunctionPrototype& prototype = *function.prototype;
+    prototype.slotCount = endScope();
+    prototype.params.clear();
+    for (const Token& param : *function.params) {
+        prototype.params.emplace_back(param.lexeme);
+    }
+    prototype.body = *function.body;
+
+    resolvePending(nested);
+
+    scopes = enclosingScopes;
+    visible = enclosingVisible;
+    functions = enclosingFunctions;
+    pending = enclosingPending;
+}
+
+// Queues a function body, recording which variables of the surrounding scopes
+// exist at this point
+void Resolver::deferFunction(const std::vector<Token>& params, const std::vector<Stmt*>& body,
+                             FunctionPrototype& prototype) {
+    std::vector<int> reach(scopes.size());
+    for (size_t i = 0; i < scopes.size(); i++) {
+        reach[i] = std::min(visible[i], scopes[i]->declared);
+    }
+    pending->push_back(PendingFunction{&params, &body, &prototype, scopes, std::move(reach), functions});
+}
+
+void Resolver::beginScope(bool hasStorage) {
+    visible.push_back(INT_MAX);
+    scopes.push_back(std::make_shared<Scope>());
+    scopes.back()->function = functions.size();
+    scopes.back()->hasStorage = hasStorage;
+}
+
+int Resolver::endScope() {
+    int slotCount = scopes.back()->slotCount;
+    scopes.pop_back();
+    visible.pop_back();
+    return slotCount;
+}
+
+// The innermost scope of the current function with storage of its own
+Resolver::Scope* Resolver::storage() {
+    for (auto it = scopes.rbegin(); it != scopes.rend() && (*it)->function == functions.size(); ++it) {
+        if ((*it)->hasStorage) {
+            return it->get();
+        }
+    }
+    return nullptr;
+}
+
+int Resolver::declare(const Token& name) {
+    if (scopes.empty()) {
+        return -1;
+    }
+
+    Scope& scope = *scopes.back();
+    auto it = scope.locals.find(name.symbol);
+    if (it != scope.locals.end()) {
+        return it->second.slot;  // redeclaration reuses the slot
+    }
+    int slot = storage()->slotCount++;
+    scope.locals.emplace(name.symbol, Local{slot, scope.declared++});
+    return slot;
+}
+
+// Runtime scopes between a variable of scopes[scopeIndex] and code whose
+// innermost scope is scopes[innermost]
+int Resolver::depthBetween(size_t scopeIndex, size_t innermost) const {
+    int depth = 0;
+    for (size_t i = scopeIndex + 1; i <= innermost; i++) {
+        if (scopes[i]->hasStorage) {
+            depth++;
+        }
+    }
+    return depth;
+}
+
+// Whether statements declare anything directly, i.e. need storage of their own
+static bool declaresVariables(const std::vector<Stmt*>& statements) {
+    for (Stmt* statement : statements) {
+        if (nodeCast<VarStmt>(statement) || nodeCast<FunctionStmt>(statement)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Resolver::resolveLocal(const Token& name, int& depth, int& slot, int& upvalue) {
+    depth = -1;
+    slot = -1;
+    upvalue = -1;
+    int i = static_cast<int>(scopes.size()) - 1;
+    for (; i >= 0 && scopes[i]->function == functions.size(); i--) {
+        auto it = scopes[i]->locals.find(name.symbol);
+        if (it != scopes[i]->locals.end()) {
+            depth = depthBetween(i, scopes.size() - 1);
+            slot = it->second.slot;
+            return;
+        }
+    }
+    int outer = captureOuter(name.symbol, i);
+    if (outer != FunctionPrototype::FALLBACK_GLOBAL) {
+        upvalue = outer;
+    }
+}
+
+// Upvalue of the running function for the innermost variable called name in
+// scopes[0..scopeIndex], which belong to enclosing functions, or
+// FALLBACK_GLOBAL when there is none. A variable declared after the running
+// function was created falls back to the next one further out.
+int Resolver::captureOuter(Symbol name, int scopeIndex) {
+    for (int i = scopeIndex; i >= 0; i--) {
+        auto it = scopes[i]->locals.find(name);
+        if (it == scopes[i]->locals.end()) {
+            continue;
+        }
+        const Local& local = it->second;
+        int fallback = FunctionPrototype::NO_FALLBACK;
+        if (local.order >= visible[i]) {
+            fallback = captureOuter(name, i - 1);
+        }
+        return capture(functions.size(), i, local.slot, fallback);
+    }
+    return FunctionPrototype::FALLBACK_GLOBAL;
+}
+
+// Index of the upvalue through which the function at nesting level reaches
+// slot of scopes[scopeIndex], a scope of an enclosing function. Functions in
+// between capture it too, so each closure can take it from the one creating
+// it; fallback applies to the entry of the function at level.
+int Resolver::capture(size_t level, size_t scopeIndex, int slot, int fallback) {
+    FunctionPrototype::Capture entry{};
+    if (scopes[scopeIndex]->function == level - 1) {
+        // Depth is counted from the innermost scope where the function was declared
+        size_t declared = scopeIndex + 1;
+        while (scopes[declared]->function < level) {
+            declared++;
+        }
+        entry = {true, depthBetween(scopeIndex, declared - 1), slot};
+        if (level > 1) {
+            functions[level - 2]->frameCaptured = true;
+        }
+    } else {
+        entry = {false, 0, capture(level - 1, scopeIndex, slot, FunctionPrototype::NO_FALLBACK)};
+    }
+    entry.fallback = fallback;
+
+    std::vector<FunctionPrototype::Capture>& upvalues = functions[level - 1]->upvalues;
+    for (size_t i = 0; i < upvalues.size(); i++) {
+        if (upvalues[i].isLocal == entry.isLocal && upvalues[i].depth == entry.depth &&
+            upvalues[i].index == entry.index) {
+            if (fallback != FunctionPrototype::NO_FALLBACK) {
+                upvalues[i].fallback = fallback;
+            }
+            return static_cast<int>(i);
+        }
+    }
+    upvalues.push_back(entry);
+    return static_cast<int>(upvalues.size() - 1);
+}
+
+Value Resolver::visitAssignExpr(AssignExpr& expression) {
+    resolve(expression.value);
+    resolveLocal(expression.name, expression.depth, expression.slot, expression.upvalue);
+    return NONE_VALUE;
+}
+
+Value Resolver::visitBinaryExpr(BinaryExpr& expression) {
+    resolve(expression.left);
+    resolve(expression.right);
+    return NONE_VALUE;
+}
+
+Value Resolver::visitCallExpr(CallExpr& expression) {
+    resolve(expression.callee);
+    for (const auto& argument : expression.arguments) {
+        resolve(argument);
+    }
+    return NONE_VALUE;
+}
+
+Value Resolver::visitFunctionExpr(FunctionExpr& expression) {
+    deferFunction(expression.params, expression.body, expression.prototype);
+    return NONE_VALUE;
+}
+
+Value Resolver::visitGroupingExpr(GroupingExpr& expression) {
+    resolve(expression.expression);
+    return NONE_VALUE;
+}
+
+Value Resolver::visitIncrementExpr(IncrementExpr& expression) {
+    resolve(expression.operand);
+    if (auto varExpr = nodeCast<VarExpr>(expression.operand)) {
+        expression.depth = varExpr->depth;
+        expression.slot = varExpr->slot;
+        expression.upvalue = varExpr->upvalue;
+    }
+    return NONE_VALUE;
+}
+
+Value Resolver::visitLiteralExpr(LiteralExpr& expression) {
+    return NONE_VALUE;
+}
+
+Value Resolver::visitLogicalExpr(LogicalExpr& expression) {
+    resolve(expression.left);
+    resolve(expression.right);
+    return NONE_VALUE;
+}
+
+Value Resolver::visitUnaryExpr(UnaryExpr& expression) {
+    resolve(expression.right);
+    return NONE_VALUE;
+}
+
+Value Resolver::visitVarExpr(VarExpr& expression) {
+    resolveLocal(expression.name, expression.depth, expression.slot, expression.upvalue);
+    return NONE_VALUE;
+}
+
+void Resolver::visitBlockStmt(BlockStmt& statement, ExecutionContext* context) {
+    statement.hasScope = storage() == nullptr && declaresVariables(statement.statements);
+    beginScope(statement.hasScope);
+    for (const auto& s : statement.statements) {
+        resolve(s);
+    }
+    statement.slotCount = endScope();
+}
+
+void Resolver::visitExpressionStmt(ExpressionStmt& statement, ExecutionContext* context) {
+    resolve(statement.expression);
+}
+
+void Resolver::visitVarStmt(VarStmt& statement, ExecutionContext* context) {
+    if (statement.initializer != nullptr) {
+        resolve(statement.initializer);
+    }
+    statement.slot = declare(statement.name);
+}
+
+void Resolver::visitFunctionStmt(FunctionStmt& statement, ExecutionContext* context) {
+    statement.slot = declare(statement.name);
+    deferFunction(statement.params, statement.body, statement.prototype);
+}
+
+void Resolver::visitReturnStmt(ReturnStmt& statement, ExecutionContext* context) {
+    if (statement.value != nullptr) {
+        resolve(statement.value);
+    }
+}
+
+void Resolver::visitIfStmt(IfStmt& statement, ExecutionContext* context) {
+    resolve(statement.condition);
+    resolve(statement.thenBranch);
+    if (statement.elseBranch != nullptr) {
+        resolve(statement.elseBranch);
+    }
+}
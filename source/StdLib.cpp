@@ -3,10 +3,10 @@
 #include "../headers/ErrorReporter.h"
 #include <chrono>
 
-void StdLib::addToEnvironment(std::shared_ptr<Environment> env, Interpreter& interpreter, ErrorReporter* errorReporter) {
+void StdLib::addToEnvironment(const EnvironmentRef& env, Interpreter& interpreter, ErrorReporter* errorReporter) {
     // Create a built-in toString function
     auto toStringFunc = std::make_shared<BuiltinFunction>("toString",
-        [&interpreter, errorReporter](std::vector<Value> args, int line, int column) -> Value {
+        [&interpreter, errorReporter](Arguments args, int line, int column) -> Value {
             if (args.size() != 1) {
                 if (errorReporter) {
                     errorReporter->reportError(line, column, "StdLib Error", 
@@ -24,7 +24,7 @@ void StdLib::addToEnvironment(std::shared_ptr<Environment> env, Interpreter& int
 
     // Create a built-in print function
     auto printFunc = std::make_shared<BuiltinFunction>("print", 
-        [&interpreter, errorReporter](std::vector<Value> args, int line, int column) -> Value {
+        [&interpreter, errorReporter](Arguments args, int line, int column) -> Value {
             if (args.size() != 1) {
                 if (errorReporter) {
                     errorReporter->reportError(line, column, "StdLib Error", 
@@ -43,7 +43,7 @@ void StdLib::addToEnvironment(std::shared_ptr<Environment> env, Interpreter& int
 
     // Create a built-in assert function
     auto assertFunc = std::make_shared<BuiltinFunction>("assert",
-        [errorReporter](std::vector<Value> args, int line, int column) -> Value {
+        [errorReporter](Arguments args, int line, int column) -> Value {
             if (args.size() != 1 && args.size() != 2) {
                 if (errorReporter) {
                     errorReporter->reportError(line, column, "StdLib Error", 
@@ -84,7 +84,7 @@ void StdLib::addToEnvironment(std::shared_ptr<Environment> env, Interpreter& int
 
     // Create a built-in time function (returns microseconds since Unix epoch)
     auto timeFunc = std::make_shared<BuiltinFunction>("time",
-        [errorReporter](std::vector<Value> args, int line, int column) -> Value {
+        [errorReporter](Arguments args, int line, int column) -> Value {
             if (args.size() != 0) {
                 if (errorReporter) {
                     errorReporter->reportError(line, column, "StdLib Error", 
@@ -106,7 +106,7 @@ void StdLib::addToEnvironment(std::shared_ptr<Environment> env, Interpreter& int
 
     // Create a built-in input function
     auto inputFunc = std::make_shared<BuiltinFunction>("input",
-        [&interpreter, errorReporter](std::vector<Value> args, int line, int column) -> Value {
+        [&interpreter, errorReporter](Arguments args, int line, int column) -> Value {
             if (args.size() > 1) {
                 if (errorReporter) {
                     errorReporter->reportError(line, column, "StdLib Error", 
@@ -133,7 +133,7 @@ void StdLib::addToEnvironment(std::shared_ptr<Environment> env, Interpreter& int
 
     // Create a built-in type function
     auto typeFunc = std::make_shared<BuiltinFunction>("type",
-        [errorReporter](std::vector<Value> args, int line, int column) -> Value {
+        [errorReporter](Arguments args, int line, int column) -> Value {
             if (args.size() != 1) {
                 if (errorReporter) {
                     errorReporter->reportError(line, column, "StdLib Error", 
@@ -168,7 +168,7 @@ void StdLib::addToEnvironment(std::shared_ptr<Environment> env, Interpreter& int
 
     // Create a built-in toNumber function for string-to-number conversion
     auto toNumberFunc = std::make_shared<BuiltinFunction>("toNumber",
-        [](std::vector<Value> args, int line, int column) -> Value {
+        [](Arguments args, int line, int column) -> Value {
             if (args.size() != 1) {
                 return NONE_VALUE;  // Return none for wrong argument count
             }
@@ -203,7 +203,7 @@ void StdLib::addToEnvironment(std::shared_ptr<Environment> env, Interpreter& int
 
     // Create a built-in toBoolean function for explicit boolean conversion
     auto toBooleanFunc = std::make_shared<BuiltinFunction>("toBoolean",
-        [errorReporter](std::vector<Value> args, int line, int column) -> Value {
+        [errorReporter](Arguments args, int line, int column) -> Value {
             if (args.size() != 1) {
                 if (errorReporter) {
                     errorReporter->reportError(line, column, "StdLib Error", 
@@ -241,7 +241,7 @@ void StdLib::addToEnvironment(std::shared_ptr<Environment> env, Interpreter& int
 
     // Create a built-in exit function to terminate the program
     auto exitFunc = std::make_shared<BuiltinFunction>("exit",
-        [](std::vector<Value> args, int line, int column) -> Value {
+        [&interpreter](Arguments args, int line, int column) -> Value {
             int exitCode = 0;  // Default exit code
             
             if (args.size() > 0) {
@@ -251,6 +251,7 @@ void StdLib::addToEnvironment(std::shared_ptr<Environment> env, Interpreter& int
                 // If not a number, just use default exit code 0
             }
             
+            interpreter.runExitHook();
             std::exit(exitCode);
             return NONE_VALUE;  // This line should never be reached
         });
@@ -0,0 +1,33 @@
+#include "../headers/Symbol.h"
+#include <deque>
+#include <string>
+#include <unordered_map>
+
+namespace {
+struct Symbols {
+    std::deque<std::string> names;  // deque keeps the views in ids stable
+    std::unordered_map<std::string_view, Symbol> ids;
+};
+
+// Never destroyed, so names stay readable from static destructors
+Symbols& symbols() {
+    static auto* table = new Symbols();
+    return *table;
+}
+}
+
+Symbol SymbolTable::intern(std::string_view name) {
+    Symbols& table = symbols();
+    auto found = table.ids.find(name);
+    if (found != table.ids.end()) {
+        return found->second;
+    }
+    Symbol symbol = static_cast<Symbol>(table.names.size());
+    table.names.emplace_back(name);
+    table.ids.emplace(table.names.back(), symbol);
+    return symbol;
+}
+
+std::string_view SymbolTable::name(Symbol symbol) {
+    return symbols().names[symbol];
+}
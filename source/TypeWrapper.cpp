@@ -2,5 +2,20 @@
 // Created by Bobby Lucero on 5/27/23.
 //
 #include "../headers/TypeWrapper.h"
+#include "../headers/Environment.h"
 #include <iostream>
 
+Function::Function(const FunctionPrototype* prototype, Environment* scope, const Function* enclosing)
+    : prototype(prototype) {
+    upvalues.reserve(prototype->upvalues.size());
+    for (const FunctionPrototype::Capture& capture : prototype->upvalues) {
+        if (capture.isLocal) {
+            upvalues.push_back(scope->ancestor(capture.depth)->capture(capture.index));
+        } else {
+            upvalues.push_back(enclosing->upvalues[capture.index]);
+        }
+    }
+}
+
+Function::~Function() = default;
+
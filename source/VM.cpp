@@ -0,0 +1,515 @@
+#include "../headers/VM.h"
+#include "../headers/Interpreter.h"
+#include "../headers/ErrorReporter.h"
+#include "../headers/Profiler.h"
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+static inline uint8_t readByte(uint8_t*& ip) {
+    return *ip++;
+}
+
+static inline uint16_t readShort(uint8_t*& ip) {
+    uint16_t value = static_cast<uint16_t>(ip[0] | (ip[1] << 8));
+    ip += 2;
+    return value;
+}
+
+static inline uint32_t readInt(uint8_t*& ip) {
+    uint32_t value = static_cast<uint32_t>(ip[0]) | (static_cast<uint32_t>(ip[1]) << 8) |
+                     (static_cast<uint32_t>(ip[2]) << 16) | (static_cast<uint32_t>(ip[3]) << 24);
+    ip += 4;
+    return value;
+}
+
+void VM::run(const std::shared_ptr<Chunk>& script, const EnvironmentRef& globalScope) {
+    stack.clear();
+    frames.clear();
+    globals = globalScope;
+    environment = globals;
+    frames.push_back(CallFrame{nullptr, script.get(), script->code.data(), globals, 0});
+
+    try {
+        execute();
+    } catch (...) {
+        // Leave the VM clean for the next REPL line
+        stack.clear();
+        frames.clear();
+        environment = nullptr;
+        globals = nullptr;
+        throw;
+    }
+
+    stack.clear();
+    frames.clear();
+    environment = nullptr;
+    globals = nullptr;
+}
+
+void VM::markRoots(GarbageCollector& collector) {
+    for (const Value& value : stack) {
+        collector.markValue(value);
+    }
+    for (const CallFrame& frame : frames) {
+        if (frame.function != nullptr) {
+            collector.markFunction(frame.function);
+        }
+    }
+}
+
+void VM::execute() {
+    CallFrame* frame = &frames.back();
+    Chunk* chunk = frame->chunk;
+    uint8_t* ip = frame->ip;
+
+    for (;;) {
+        switch (static_cast<OpCode>(readByte(ip))) {
+            case OP_CONSTANT:
+                push(chunk->constants[readInt(ip)]);
+                break;
+            case OP_NONE:
+                push(NONE_VALUE);
+                break;
+            case OP_TRUE:
+                push(TRUE_VALUE);
+                break;
+            case OP_FALSE:
+                push(FALSE_VALUE);
+                break;
+            case OP_POP:
+                stack.pop_back();
+                break;
+            case OP_ECHO: {
+                Value value = pop();
+                std::cout << "\u001b[38;5;8m[" << interpreter.stringify(value) << "]\u001b[38;5;15m" << std::endl;
+                break;
+            }
+
+            case OP_DEFINE_GLOBAL: {
+                const Token& name = chunk->tokens[readInt(ip)];
+                globals->define(name.symbol, peek());
+                stack.pop_back();
+                break;
+            }
+            case OP_GET_GLOBAL: {
+                const Token& name = chunk->tokens[readInt(ip)];
+                push(globals->lookup(chunk->globalCaches[readInt(ip)], name));
+                break;
+            }
+            case OP_SET_GLOBAL: {
+                const Token& name = chunk->tokens[readInt(ip)];
+                globals->lookup(chunk->globalCaches[readInt(ip)], name) = peek();
+                break;
+            }
+            case OP_DEFINE_LOCAL:
+                environment->slot(readShort(ip)) = pop();
+                break;
+            case OP_GET_LOCAL: {
+                uint16_t depth = readShort(ip);
+                push(environment->at(depth, readShort(ip)));
+                break;
+            }
+            case OP_SET_LOCAL: {
+                uint16_t depth = readShort(ip);
+                environment->at(depth, readShort(ip)) = peek();
+                break;
+            }
+            case OP_DEFINE_STACK:
+                stack[frame->stackBase + 1 + readShort(ip)] = pop();
+                break;
+            case OP_GET_STACK:
+                push(stack[frame->stackBase + 1 + readShort(ip)]);
+                break;
+            case OP_SET_STACK:
+                stack[frame->stackBase + 1 + readShort(ip)] = peek();
+                break;
+            case OP_GET_UPVALUE:
+                push(frame->function->upvalue(readShort(ip)));
+                break;
+            case OP_SET_UPVALUE:
+                frame->function->upvalue(readShort(ip)) = peek();
+                break;
+            case OP_GET_UPVALUE_OR_GLOBAL: {
+                Value* value = frame->function->binding(readShort(ip));
+                const Token& name = chunk->tokens[readInt(ip)];
+                GlobalCache& cache = chunk->globalCaches[readInt(ip)];
+                push(value ? *value : globals->lookup(cache, name));
+                break;
+            }
+            case OP_SET_UPVALUE_OR_GLOBAL: {
+                Value* value = frame->function->binding(readShort(ip));
+                const Token& name = chunk->tokens[readInt(ip)];
+                GlobalCache& cache = chunk->globalCaches[readInt(ip)];
+                (value ? *value : globals->lookup(cache, name)) = peek();
+                break;
+            }
+            case OP_COMPOUND_ASSIGN: {
+                const Token& name = chunk->tokens[readInt(ip)];
+                const Token& op = chunk->tokens[readInt(ip)];
+                uint16_t depth = readShort(ip);
+                uint16_t slot = readShort(ip);
+                GlobalCache& cache = chunk->globalCaches[readInt(ip)];
+                Value* target = variable(frame, depth, slot);
+                Value& variable = target ? *target : globals->lookup(cache, name);
+                if (op.type != PLUS_EQUAL || !variable.appendInPlace(peek())) {
+                    variable = interpreter.binaryOperation(op, variable, peek());
+                }
+                peek() = variable;
+                break;
+            }
+            case OP_INCREMENT: {
+                const Token& name = chunk->tokens[readInt(ip)];
+                const Token& oper = chunk->tokens[readInt(ip)];
+                bool isPrefix = readByte(ip) != 0;
+                uint16_t depth = readShort(ip);
+                uint16_t slot = readShort(ip);
+                GlobalCache& cache = chunk->globalCaches[readInt(ip)];
+                Value* target = variable(frame, depth, slot);
+                Value& variable = target ? *target : globals->lookup(cache, name);
+                Value currentValue = variable;
+                if (!currentValue.isNumber()) {
+                    if (errorReporter) {
+                        errorReporter->reportError(oper.line, oper.column,
+                            "Runtime Error", "Increment/decrement can only be applied to numbers.", "");
+                    }
+                    throw std::runtime_error("Increment/decrement can only be applied to numbers.");
+                }
+                Value newValue = interpreter.incrementOperation(oper, currentValue);
+                variable = newValue;
+                push(isPrefix ? newValue : currentValue);
+                break;
+            }
+
+            case OP_BINARY: {
+                // First execution: specialize this site on the operand types
+                uint8_t* site = ip - 1;
+                const Token& oper = chunk->tokens[readInt(ip)];
+                Value right = pop();
+                Value& left = peek();
+                *site = quickenedBinaryOpcode(quickenBinary(oper.type, left, right));
+                left = interpreter.binaryOperation(oper, left, right);
+                break;
+            }
+            case OP_BINARY_GENERIC: {
+                const Token& oper = chunk->tokens[readInt(ip)];
+                Value right = pop();
+                Value& left = peek();
+                left = interpreter.binaryOperation(oper, left, right);
+                break;
+            }
+
+// Specialized number operator; on other operand types the site is rewritten
+// to the generic form and the instruction is dispatched again
+#define NUMBER_BINARY(opcode, guard, result)                      \
+            case opcode: {                                        \
+                Value& left = peek(1);                            \
+                const Value& right = peek();                      \
+                if (mixedOrDoubles(left, right)) {                \
+                    double a = left.asNumber();                   \
+                    double b = right.asNumber();                  \
+                    if (guard) {                                  \
+                        left = Value(result);                     \
+                        stack.pop_back();                         \
+                        ip += 4;                                  \
+                        break;                                    \
+                    }                                             \
+                }                                                 \
+                *--ip = OP_BINARY_GENERIC;                        \
+                break;                                            \
+            }
+
+            NUMBER_BINARY(OP_ADD_NUMBERS, true, a + b)
+            NUMBER_BINARY(OP_SUBTRACT_NUMBERS, true, a - b)
+            NUMBER_BINARY(OP_MULTIPLY_NUMBERS, true, a * b)
+            NUMBER_BINARY(OP_DIVIDE_NUMBERS, b != 0, a / b)
+            NUMBER_BINARY(OP_MODULO_NUMBERS, b != 0, std::fmod(a, b))
+#undef NUMBER_BINARY
+
+// Specialized number comparison; exact when an integer meets a double
+#define NUMBER_COMPARE(opcode, token)                             \
+            case opcode: {                                        \
+                Value& left = peek(1);                            \
+                const Value& right = peek();                      \
+                if (mixedOrDoubles(left, right)) {                \
+                    left = Value(orderSatisfies(token, Value::compareNumbers(left, right))); \
+                    stack.pop_back();                             \
+                    ip += 4;                                      \
+                    break;                                        \
+                }                                                 \
+                *--ip = OP_BINARY_GENERIC;                        \
+                break;                                            \
+            }
+
+            NUMBER_COMPARE(OP_LESS_NUMBERS, LESS)
+            NUMBER_COMPARE(OP_LESS_EQUAL_NUMBERS, LESS_EQUAL)
+            NUMBER_COMPARE(OP_GREATER_NUMBERS, GREATER)
+            NUMBER_COMPARE(OP_GREATER_EQUAL_NUMBERS, GREATER_EQUAL)
+            NUMBER_COMPARE(OP_EQUAL_NUMBERS, DOUBLE_EQUAL)
+            NUMBER_COMPARE(OP_NOT_EQUAL_NUMBERS, BANG_EQUAL)
+#undef NUMBER_COMPARE
+
+// Specialized integer operator; the QuickOp is a constant, so the switches in
+// integerToken and integerBinary fold away
+#define INTEGER_BINARY(opcode, quick)                             \
+            case opcode: {                                        \
+                Value& left = peek(1);                            \
+                const Value& right = peek();                      \
+                if (left.isInteger() && right.isInteger() &&      \
+                    quickIntegers(quick, left.asInteger(), right.asInteger(), left)) { \
+                    stack.pop_back();                             \
+                    ip += 4;                                      \
+                    break;                                        \
+                }                                                 \
+                *--ip = OP_BINARY_GENERIC;                        \
+                break;                                            \
+            }
+
+            INTEGER_BINARY(OP_ADD_INTEGERS, QuickOp::AddIntegers)
+            INTEGER_BINARY(OP_SUBTRACT_INTEGERS, QuickOp::SubtractIntegers)
+            INTEGER_BINARY(OP_MULTIPLY_INTEGERS, QuickOp::MultiplyIntegers)
+            INTEGER_BINARY(OP_DIVIDE_INTEGERS, QuickOp::DivideIntegers)
+            INTEGER_BINARY(OP_MODULO_INTEGERS, QuickOp::ModuloIntegers)
+            INTEGER_BINARY(OP_LESS_INTEGERS, QuickOp::LessIntegers)
+            INTEGER_BINARY(OP_LESS_EQUAL_INTEGERS, QuickOp::LessEqualIntegers)
+            INTEGER_BINARY(OP_GREATER_INTEGERS, QuickOp::GreaterIntegers)
+            INTEGER_BINARY(OP_GREATER_EQUAL_INTEGERS, QuickOp::GreaterEqualIntegers)
+            INTEGER_BINARY(OP_EQUAL_INTEGERS, QuickOp::EqualIntegers)
+            INTEGER_BINARY(OP_NOT_EQUAL_INTEGERS, QuickOp::NotEqualIntegers)
+            INTEGER_BINARY(OP_BIT_AND_INTEGERS, QuickOp::BitAndIntegers)
+            INTEGER_BINARY(OP_BIT_OR_INTEGERS, QuickOp::BitOrIntegers)
+            INTEGER_BINARY(OP_BIT_XOR_INTEGERS, QuickOp::BitXorIntegers)
+            INTEGER_BINARY(OP_SHIFT_LEFT_INTEGERS, QuickOp::ShiftLeftIntegers)
+            INTEGER_BINARY(OP_SHIFT_RIGHT_INTEGERS, QuickOp::ShiftRightIntegers)
+#undef INTEGER_BINARY
+
+            case OP_CONCAT_STRINGS:
+            case OP_EQUAL_STRINGS:
+            case OP_NOT_EQUAL_STRINGS: {
+                Value& left = peek(1);
+                if (quickBinary(quickOpOf(static_cast<OpCode>(ip[-1])), left, peek(), left)) {
+                    stack.pop_back();
+                    ip += 4;
+                } else {
+                    *--ip = OP_BINARY_GENERIC;
+                }
+                break;
+            }
+
+            case OP_NEGATE: {
+                uint8_t* site = ip - 1;
+                const Token& oper = chunk->tokens[readInt(ip)];
+                *site = quickenUnary(oper.type, peek()) == QuickOp::NegateNumber ? OP_NEGATE_NUMBER : OP_NEGATE_GENERIC;
+                peek() = interpreter.unaryOperation(oper, peek());
+                break;
+            }
+            case OP_NEGATE_NUMBER:
+                if (peek().isNumber() && numberUnary(MINUS, peek(), peek())) {
+                    ip += 4;
+                } else {
+                    *--ip = OP_NEGATE_GENERIC;
+                }
+                break;
+            case OP_NEGATE_GENERIC:
+            case OP_BIN_NOT: {
+                const Token& oper = chunk->tokens[readInt(ip)];
+                peek() = interpreter.unaryOperation(oper, peek());
+                break;
+            }
+            case OP_NOT:
+                peek() = Value(!interpreter.isTruthy(peek()));
+                break;
+
+            case OP_JUMP:
+                ip = chunk->code.data() + readInt(ip);
+                break;
+            case OP_JUMP_IF_FALSE: {
+                uint32_t target = readInt(ip);
+                if (!interpreter.isTruthy(peek())) {
+                    ip = chunk->code.data() + target;
+                }
+                stack.pop_back();
+                break;
+            }
+            case OP_JUMP_IF_TRUE: {
+                uint32_t target = readInt(ip);
+                if (interpreter.isTruthy(peek())) {
+                    ip = chunk->code.data() + target;
+                }
+                stack.pop_back();
+                break;
+            }
+            case OP_JUMP_IF_FALSE_OR_POP: {
+                uint32_t target = readInt(ip);
+                if (!interpreter.isTruthy(peek())) {
+                    ip = chunk->code.data() + target;
+                } else {
+                    stack.pop_back();
+                }
+                break;
+            }
+            case OP_JUMP_IF_TRUE_OR_POP: {
+                uint32_t target = readInt(ip);
+                if (interpreter.isTruthy(peek())) {
+                    ip = chunk->code.data() + target;
+                } else {
+                    stack.pop_back();
+                }
+                break;
+            }
+
+            case OP_PUSH_SCOPE: {
+                environment = Environment::create(environment, readShort(ip));
+                break;
+            }
+            case OP_POP_SCOPE:
+                environment = environment->getParent();
+                break;
+
+            case OP_CLOSURE: {
+                const FunctionPrototype* prototype = chunk->functions[readInt(ip)];
+                Function* function = interpreter.getCollector().newFunction(prototype, environment.get(), frame->function);
+                push(Value(function));
+                break;
+            }
+            case OP_CALL: {
+                int argCount = readByte(ip);
+                const Token& paren = chunk->tokens[readInt(ip)];
+                frame->ip = ip;
+                callValue(peek(argCount), argCount, paren, frame);
+                chunk = frame->chunk;
+                ip = frame->ip;
+                break;
+            }
+            case OP_TAIL_CALL: {
+                int argCount = readByte(ip);
+                const Token& paren = chunk->tokens[readInt(ip)];
+                const Value& callee = peek(argCount);
+                if (callee.isFunction() && frame->function != nullptr) {
+                    tailCall(callee.asFunction(), argCount, frame);
+                } else {
+                    frame->ip = ip;
+                    callValue(callee, argCount, paren, frame);
+                }
+                chunk = frame->chunk;
+                ip = frame->ip;
+                break;
+            }
+            case OP_RETURN: {
+                Value result = pop();
+                if (frames.size() == 1) {
+                    return;
+                }
+                environment = std::move(frame->previousEnv);
+                stack.resize(frame->stackBase);
+                frames.pop_back();
+                if (profiler) profiler->exit();
+                frame = &frames.back();
+                chunk = frame->chunk;
+                ip = frame->ip;
+                push(std::move(result));
+                break;
+            }
+        }
+    }
+}
+
+void VM::callValue(const Value& callee, int argCount, const Token& paren, CallFrame*& frame) {
+    size_t base = stack.size() - argCount - 1;
+
+    if (callee.isBuiltinFunction()) {
+        BuiltinFunction* builtin = callee.asBuiltinFunction();
+        if (profiler) profiler->enter(builtin->name);
+        Value result = builtin->func(Arguments{stack.data() + base + 1, static_cast<size_t>(argCount)},
+                                     paren.line, paren.column);
+        if (profiler) profiler->exit();
+        stack.resize(base);
+        push(std::move(result));
+        return;
+    }
+
+    if (callee.isFunction()) {
+        Function* function = callee.asFunction();
+        checkCall(function, argCount);
+        if (frames.size() >= VM_FRAMES_MAX) {
+            throw std::runtime_error("Stack overflow: maximum call depth exceeded.");
+        }
+
+        const FunctionPrototype& prototype = *function->prototype;
+        if (!prototype.frameCaptured) {
+            // The arguments already sit where the frame's first slots go
+            stack.resize(base + 1 + prototype.slotCount);
+            frames.push_back(CallFrame{function, prototype.chunk.get(), prototype.chunk->code.data(),
+                                       environment, base});
+            frame = &frames.back();
+            if (profiler) profiler->enter(prototype.name);
+            return;
+        }
+
+        auto callEnv = Environment::create(globals, prototype.slotCount);
+        for (int i = 0; i < argCount; i++) {
+            callEnv->slot(i) = std::move(stack[base + 1 + i]);
+        }
+        stack.resize(base);
+
+        frames.push_back(CallFrame{function, prototype.chunk.get(), prototype.chunk->code.data(),
+                                   std::move(environment), base});
+        frame = &frames.back();
+        environment = std::move(callEnv);
+        if (profiler) profiler->enter(prototype.name);
+        return;
+    }
+
+    throw std::runtime_error("Can only call functions and classes.");
+}
+
+void VM::checkCall(Function* function, int argCount) {
+    const FunctionPrototype& prototype = *function->prototype;
+    if (static_cast<size_t>(argCount) != prototype.params.size()) {
+        throw std::runtime_error("Expected " + std::to_string(prototype.params.size()) +
+                               " arguments but got " + std::to_string(argCount) + ".");
+    }
+    if (!prototype.chunk) {
+        throw std::runtime_error("Function '" + prototype.name + "' has no compiled body.");
+    }
+}
+
+// Replace the current frame with a call to function. The frame keeps its
+// stack base and return target and reuses its environment, so tail-recursive
+// loops run in constant space.
+void VM::tailCall(Function* function, int argCount, CallFrame* frame) {
+    checkCall(function, argCount);
+    size_t base = stack.size() - argCount - 1;
+
+    const FunctionPrototype& prototype = *function->prototype;
+    if (!prototype.frameCaptured) {
+        // Slide the callee and arguments down over the old frame (a frame
+        // in an Environment left nothing on the stack, so they may be in place)
+        size_t frameBase = frame->stackBase;
+        if (base != frameBase) {
+            stack[frameBase] = std::move(stack[base]);
+            for (int i = 0; i < argCount; i++) {
+                stack[frameBase + 1 + i] = std::move(stack[base + 1 + i]);
+            }
+        }
+        stack.resize(frameBase + 1 + argCount);
+        stack.resize(frameBase + 1 + prototype.slotCount);
+        environment = frame->previousEnv;
+    } else {
+        if (environment.useCount() == 1) {
+            environment->setParent(globals);
+            environment->resetSlots(prototype.slotCount);
+        } else {
+            environment = Environment::create(globals, prototype.slotCount);
+        }
+        for (int i = 0; i < argCount; i++) {
+            environment->slot(i) = std::move(stack[base + 1 + i]);
+        }
+        stack.resize(frame->stackBase);
+    }
+
+    if (profiler) profiler->tailCall(prototype.name);
+    frame->function = function;
+    frame->chunk = prototype.chunk.get();
+    frame->ip = prototype.chunk->code.data();
+}
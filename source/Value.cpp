@@ -5,4 +5,156 @@ const Value NONE_VALUE = Value();
 const Value TRUE_VALUE = Value(true);
 const Value FALSE_VALUE = Value(false);
 const Value ZERO_VALUE = Value(0.0);
-const Value ONE_VALUE = Value(1.0); 
\ No newline at end of file
+const Value ONE_VALUE = Value(1.0); 
+
+// Open-addressed set of the interned strings, probed with their cached hash.
+// Removal leaves a tombstone that insertions reuse; growing drops them.
+// Never destroyed, so strings held by static Values can still be released
+// during exit.
+namespace {
+class InternTable {
+public:
+    StringObject* find(std::string_view text, size_t hash) const {
+        if (slots.empty()) return nullptr;
+        size_t mask = slots.size() - 1;
+        for (size_t index = hash & mask;; index = (index + 1) & mask) {
+            StringObject* entry = slots[index];
+            if (entry == nullptr) return nullptr;
+            if (entry != tombstone() && entry->hashValue == hash && entry->text() == text) return entry;
+        }
+    }
+
+    void insert(StringObject* string) {
+        if ((used + 1) * 4 > slots.size() * 3) grow();
+        size_t mask = slots.size() - 1;
+        size_t index = string->hashValue & mask;
+        while (slots[index] != nullptr && slots[index] != tombstone()) {
+            index = (index + 1) & mask;
+        }
+        if (slots[index] == nullptr) used++;
+        slots[index] = string;
+    }
+
+    void erase(StringObject* string) {
+        size_t mask = slots.size() - 1;
+        size_t index = string->hashValue & mask;
+        while (slots[index] != string) {
+            index = (index + 1) & mask;
+        }
+        slots[index] = tombstone();
+    }
+
+private:
+    std::vector<StringObject*> slots;
+    size_t used = 0;  // live entries plus tombstones
+
+    static StringObject* tombstone() {
+        return reinterpret_cast<StringObject*>(uintptr_t(1));
+    }
+
+    void grow() {
+        std::vector<StringObject*> old = std::move(slots);
+        size_t live = 0;
+        for (StringObject* entry : old) {
+            if (entry != nullptr && entry != tombstone()) live++;
+        }
+        size_t capacity = 64;
+        while (capacity * 3 < (live + 1) * 8) capacity *= 2;
+        slots.assign(capacity, nullptr);
+        used = 0;
+        for (StringObject* entry : old) {
+            if (entry != nullptr && entry != tombstone()) insert(entry);
+        }
+    }
+};
+
+InternTable& internTable() {
+    static auto* table = new InternTable();
+    return *table;
+}
+}
+
+StringObject* StringObject::create(std::string str) {
+    if (str.size() <= INTERN_MAX_LENGTH) return intern(std::move(str));
+    return new StringObject(std::move(str));
+}
+
+StringObject* StringObject::intern(std::string str) {
+    InternTable& table = internTable();
+    size_t hash = std::hash<std::string_view>{}(str);
+    if (StringObject* existing = table.find(str, hash)) {
+        existing->refCount++;
+        return existing;
+    }
+    auto* string = new StringObject(std::move(str));
+    string->interned = true;
+    string->hashed = true;
+    string->hashValue = hash;
+    table.insert(string);
+    return string;
+}
+
+StringObject* StringObject::concat(StringObject* a, StringObject* b) {
+    size_t size = a->size + b->size;
+    if (size <= ROPE_MIN_LENGTH) {
+        std::string str;
+        str.reserve(size);
+        str += a->text();
+        str += b->text();
+        return create(std::move(str));
+    }
+    // Appending a short piece merges it into the rope's short last leaf, so
+    // building a string from small pieces costs a node per leaf, not per piece
+    if (a->left && !a->right->left && a->right->size + b->size <= ROPE_MIN_LENGTH) {
+        StringObject* tail = concat(a->right, b);
+        a->left->refCount++;
+        return new StringObject(a->left, tail);
+    }
+    a->refCount++;
+    b->refCount++;
+    return new StringObject(a, b);
+}
+
+// Ropes built by repeated concatenation are as deep as they are long, so
+// both flattening and destruction walk them with an explicit stack
+void StringObject::flatten() const {
+    std::string result;
+    result.reserve(size);
+    std::vector<const StringObject*> pending{right, left};
+    while (!pending.empty()) {
+        const StringObject* node = pending.back();
+        pending.pop_back();
+        if (node->left) {
+            pending.push_back(node->right);
+            pending.push_back(node->left);
+        } else {
+            result += node->flat;
+        }
+    }
+    flat = std::move(result);
+
+    StringObject* halves[] = {left, right};
+    left = right = nullptr;
+    for (StringObject* half : halves) {
+        if (--half->refCount == 0) destroy(half);
+    }
+}
+
+void StringObject::destroy(StringObject* string) {
+    if (!string->left) {
+        if (string->interned) internTable().erase(string);
+        delete string;
+        return;
+    }
+
+    std::vector<StringObject*> dead{string};
+    while (!dead.empty()) {
+        StringObject* node = dead.back();
+        dead.pop_back();
+        if (node->interned) internTable().erase(node);
+        for (StringObject* half : {node->left, node->right}) {
+            if (half && --half->refCount == 0) dead.push_back(half);
+        }
+        delete node;
+    }
+}
@@ -2,11 +2,16 @@
 
 #include "../headers/bob.h"
 #include "../headers/Parser.h"
+#include "../headers/Optimizer.h"
+#include "../headers/Resolver.h"
 using namespace std;
 
 void Bob::runFile(const string& path)
 {
     this->interpreter = msptr(Interpreter)(false);
+    interpreter->setUseBytecode(useBytecode);
+    interpreter->setExitHook([this]() { finishRun(); });
+    startProfiler();
     ifstream file = ifstream(path);
 
     string source;
@@ -27,11 +32,15 @@ void Bob::runFile(const string& path)
     interpreter->setErrorReporter(&errorReporter);
     
     this->run(source);
+    finishRun();
 }
 
 void Bob::runPrompt()
 {
     this->interpreter = msptr(Interpreter)(true);
+    interpreter->setUseBytecode(useBytecode);
+    interpreter->setExitHook([this]() { finishRun(); });
+    startProfiler();
 
     cout << "Bob v" << VERSION << ", 2023" << endl;
     for(;;)
@@ -42,6 +51,7 @@ void Bob::runPrompt()
 
         if(std::cin.eof())
         {
+            finishRun();
             break;
         }
 
@@ -55,6 +65,35 @@ void Bob::runPrompt()
     }
 }
 
+void Bob::startProfiler()
+{
+    if (!profile) return;
+    profiler = std::make_unique<Profiler>();
+    interpreter->setProfiler(profiler.get());
+}
+
+// Exit-time reports requested on the command line
+void Bob::finishRun()
+{
+    if (gcStats) {
+        interpreter->getCollector().printStats(std::cerr);
+    }
+
+    if (profiler) {
+        interpreter->setProfiler(nullptr);
+        profiler->report(std::cerr);
+
+        ofstream folded(profileOutput);
+        if (folded.is_open()) {
+            profiler->writeCollapsed(folded);
+            std::cerr << "Collapsed stacks written to " << profileOutput << std::endl;
+        } else {
+            std::cerr << "Could not write profile to " << profileOutput << std::endl;
+        }
+        profiler.reset();
+    }
+}
+
 void Bob::run(string source)
 {
     try {
@@ -62,12 +101,19 @@ void Bob::run(string source)
         lexer.setErrorReporter(&errorReporter);
         
         vector<Token> tokens = lexer.Tokenize(std::move(source));
-        Parser p(tokens);
+        Parser p(tokens, arena);
         
         // Connect error reporter to parser
         p.setErrorReporter(&errorReporter);
         
-        vector<sptr(Stmt)> statements = p.parse();
+        vector<Stmt*> statements = p.parse();
+
+        Optimizer optimizer(arena);
+        optimizer.optimize(statements);
+
+        Resolver resolver;
+        resolver.resolve(statements);
+
         interpreter->interpret(statements);
     }
     catch(std::exception &e)
@@ -5,9 +5,26 @@
 
 int main(int argc, char* argv[]){
     Bob bobLang;
+    std::string path;
 
-    if(argc > 1) {
-        bobLang.runFile(argv[1]);
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--tree-walker") {
+            bobLang.useBytecode = false;
+        } else if (arg == "--gc-stats") {
+            bobLang.gcStats = true;
+        } else if (arg == "--profile") {
+            bobLang.profile = true;
+        } else if (arg.rfind("--profile=", 0) == 0) {
+            bobLang.profile = true;
+            bobLang.profileOutput = arg.substr(10);
+        } else {
+            path = arg;
+        }
+    }
+
+    if(!path.empty()) {
+        bobLang.runFile(path);
     } else {
         bobLang.runPrompt();
     }
@@ -1,85 +1,289 @@
 //
 // Created by Bobby Lucero on 5/21/23.
 //
+// Writes headers/Expression.h and headers/Statement.h from the node lists in
+// main(). Every node gets a kind tag in its base, and each header ends with a
+// dispatch template that switches on the tag, so visiting a node is a single
+// jump instead of a virtual accept() followed by a virtual visit call.
+// Add or change node types here and regenerate with `make ast`.
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <string>
 #include <vector>
-#include <fstream>
-#include "../headers/helperFunctions/HelperFunctions.h"
-
-void defineType(std::ofstream &out, std::string baseName, std::string className, std::string fieldList)
-{
-    out << "template <typename T>\n";
-    out << "struct " << className << "Expr : " << baseName << "<T>" << ", Visitor<T>" << "\n{\n";
-    std::vector<std::string> fields = splitString(fieldList, ", ");
-    for(std::string field : fields)
-    {
-        std::cout << trim(field) << std::endl;
-        std::string fieldClass = splitString(trim(field), " ")[0];
-        std::string fieldName = splitString(trim(field), " ")[1];
-        fieldClass = trim(fieldClass) == "Expr" ? "Expr<T>" : trim(fieldClass);
-        out << "    const " << fieldClass << " " << fieldName << ";\n";
-    }
-    fieldList = replaceSubstring(fieldList, "Expr", "Expr<T>");
-    out << "\n    " << className << "Expr(" << fieldList << ") : ";
-
-    std::string explicitDeclaration;
-    for(std::string field : fields)
-    {
-        std::cout << trim(field) << std::endl;
-        std::string fieldClass = splitString(trim(field), " ")[0];
-        std::string fieldName = splitString(trim(field), " ")[1];
-        fieldClass = trim(fieldClass) == "Expr" ? "Expr<T>" : trim(fieldClass);
-
-        explicitDeclaration += trim(fieldName) + "(" + trim(fieldName) + "), ";
-    }
-    explicitDeclaration = trim(explicitDeclaration);
-    explicitDeclaration.pop_back();
 
-    out << explicitDeclaration;
+struct NodeType {
+    std::string name;                   // without the base suffix
+    std::vector<std::string> doc;       // comment lines written above the struct
+    std::vector<std::string> params;    // constructor parameters, each stored in a member of the same name
+    std::vector<std::string> members;   // other members, written as given
+    std::string constructorBody;
+    std::vector<std::string> methods;   // written as given after the constructor
+};
 
-    out << "\n    {\n";
-    out << "    }\n";
+struct AstDefinition {
+    std::string baseName;               // "Expr" or "Stmt"
+    std::string visitorResult;          // return type of the visit methods
+    std::string extraParameters;        // extra visit parameters, e.g. the execution context
+    std::string extraArguments;
+    std::string preamble;               // includes and declarations before the nodes
+    std::vector<NodeType> types;
+};
 
-    out << "    T accept(Visitor<T> visitor){\n";
-    out << "        return visitor.visit" << className << "Expr(this);\n";
-    out << "    }\n";
+static std::string strip(const std::string& text, const std::string& prefix) {
+    return text.compare(0, prefix.size(), prefix) == 0 ? text.substr(prefix.size()) : text;
+}
 
-    out << "};" << std::endl;
+// A parameter may end in a comment: "const Value value  // decoded by the Parser"
+static std::string declarationOf(const std::string& param) {
+    return param.substr(0, param.find("  //"));
 }
 
-void defineAst(std::string outputDir, std::string baseName, const std::vector<std::string>& types)
-{
-    std::ofstream outFile(outputDir);
+static std::string commentOf(const std::string& param) {
+    size_t comment = param.find("  //");
+    return comment == std::string::npos ? "" : param.substr(comment);
+}
 
-    if(outFile.is_open())
-    {
-        for(std::string type : types)
-        {
-            std::vector<std::string> type_split = splitString(type, "$");
-            std::string className = trim(type_split[0]);
-            std::string fields = trim(type_split[1]);
-            defineType(outFile, baseName, className, fields);
-        }
+static std::string fieldName(const std::string& declaration) {
+    return declaration.substr(declaration.find_last_of(" *&") + 1);
+}
+
+static std::string fieldType(const std::string& declaration) {
+    std::string type = declaration.substr(0, declaration.size() - fieldName(declaration).size());
+    while (!type.empty() && type.back() == ' ') type.pop_back();
+    return type;
+}
+
+// Containers and values are moved into place; pointers and tokens are copied
+static std::string initializer(const std::string& declaration) {
+    std::string name = fieldName(declaration);
+    std::string type = strip(fieldType(declaration), "const ");
+    bool movable = type.find("std::vector") == 0 || type == "Value";
+    return name + (movable ? "(std::move(" + name + "))" : "(" + name + ")");
+}
+
+static void defineType(std::ofstream& out, const AstDefinition& ast, const NodeType& type) {
+    const std::string className = type.name + ast.baseName;
+    for (const std::string& line : type.doc) {
+        out << "// " << line << "\n";
+    }
+    out << "struct " << className << " : " << ast.baseName << "\n{\n";
+    out << "    static constexpr " << ast.baseName << "Kind KIND = " << ast.baseName << "Kind::" << type.name << ";\n\n";
+
+    for (const std::string& param : type.params) {
+        out << "    " << declarationOf(param) << ";" << commentOf(param) << "\n";
+    }
+    for (const std::string& member : type.members) {
+        out << "    " << member << "\n";
+    }
+    out << "\n";
+
+    out << "    " << (type.params.size() == 1 ? "explicit " : "") << className << "(";
+    for (size_t i = 0; i < type.params.size(); i++) {
+        std::string declaration = declarationOf(type.params[i]);
+        out << (i ? ", " : "") << strip(fieldType(declaration), "const ") << " " << fieldName(declaration);
+    }
+    out << ")\n        : " << ast.baseName << "(KIND)";
+    for (const std::string& param : type.params) {
+        out << ", " << initializer(declarationOf(param));
+    }
+    if (type.constructorBody.empty()) {
+        out << " {}\n";
+    } else {
+        out << " { " << type.constructorBody << " }\n";
+    }
+
+    for (const std::string& line : type.methods) {
+        out << (line.empty() ? "" : "    ") << line << "\n";
     }
+    out << "};\n\n";
 }
 
+static void defineAst(const std::string& path, const AstDefinition& ast) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Could not write " << path << std::endl;
+        std::exit(74);
+    }
+    const std::string& base = ast.baseName;
 
+    out << "// Generated by tools/GenerateAST. Edit the node list in tools/GenerateAST.cpp\n";
+    out << "// and run `make ast` instead of changing this file by hand.\n\n";
+    out << "#pragma once\n";
+    out << ast.preamble << "\n";
 
-int main(int argc, char* argv[]){
-    if(argc != 2)
-    {
-        std::cerr << "Usage " << argv[0] << " <output directory>" << std::endl;
-        std::exit(64);
+    for (const NodeType& type : ast.types) {
+        out << "struct " << type.name << base << ";\n";
     }
-    std::string outputDir = argv[1];
+    out << "\n";
 
-    defineAst(outputDir, "Expr", {
-            "Binary   $ Expr left, Token oper, Expr right",
-            "Grouping $ Expr expression",
-            "Literal  $ std::string value",
-            "Unary    $ Token oper, Expr right"
-    });
+    out << "enum class " << base << "Kind : uint8_t {\n";
+    for (size_t i = 0; i < ast.types.size(); i++) {
+        out << "    " << ast.types[i].name << (i + 1 < ast.types.size() ? ",\n" : "\n");
+    }
+    out << "};\n\n";
+
+    out << "// Every visitor implements one method per node type\n";
+    out << "struct " << base << "Visitor\n{\n";
+    for (const NodeType& type : ast.types) {
+        out << "    virtual " << ast.visitorResult << " visit" << type.name << base << "(" << type.name << base
+            << "& " << (base == "Expr" ? "expr" : "stmt") << ast.extraParameters << ") = 0;\n";
+    }
+    out << "};\n\n";
+
+    out << "// AST nodes are owned by an AstArena and link to each other with plain\n";
+    out << "// pointers. The base only holds the node's kind: nodes have no vtable.\n";
+    out << "struct " << base << "\n{\n";
+    out << "    const " << base << "Kind kind;\n\n";
+    out << "protected:\n";
+    out << "    explicit " << base << "(" << base << "Kind kind) : kind(kind) {}\n";
+    out << "};\n\n";
+
+    for (const NodeType& type : ast.types) {
+        defineType(out, ast, type);
+    }
+
+    std::string parameters = ast.extraParameters;
+    if (parameters.find(" = ") != std::string::npos) {
+        parameters = parameters.substr(0, parameters.find(" = "));
+    }
+    out << "// Calls the visit method for the node's kind. With a final visitor class\n";
+    out << "// the call is direct, so a visit costs one switch and no virtual calls.\n";
+    out << "template<typename Visitor>\n";
+    out << "inline " << ast.visitorResult << " visit" << base << "(Visitor& visitor, " << base << "& node"
+        << parameters << ")\n{\n";
+    out << "    switch (node.kind) {\n";
+    for (const NodeType& type : ast.types) {
+        out << "        case " << base << "Kind::" << type.name << ":\n";
+        out << "            return visitor.visit" << type.name << base << "(static_cast<" << type.name << base
+            << "&>(node)" << ast.extraArguments << ");\n";
+    }
+    out << "    }\n";
+    out << "    __builtin_unreachable();\n";
+    out << "}\n";
 }
 
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage " << argv[0] << " <headers directory>" << std::endl;
+        std::exit(64);
+    }
+    std::string outputDir = argv[1];
+
+    const std::vector<std::string> resolvedVariable = {
+        "// Set by the Resolver: a local at (depth, slot) or an upvalue of the",
+        "// running function; a global looked up by name when both are -1",
+        "int depth = -1;",
+        "int slot = -1;",
+        "int upvalue = -1;",
+    };
+    auto withGlobalCache = [&](const std::string& comment) {
+        std::vector<std::string> members = resolvedVariable;
+        members.push_back("GlobalCache global;  // " + comment);
+        return members;
+    };
 
+    defineAst(outputDir + "/Expression.h", {
+        "Expr", "Value", "", "",
+        "#include <cstdint>\n"
+        "#include <iostream>\n"
+        "#include <memory>\n"
+        "#include <utility>\n"
+        "#include <vector>\n"
+        "#include \"Lexer.h\"\n"
+        "#include \"helperFunctions/ShortHands.h\"\n"
+        "#include \"TypeWrapper.h\"\n"
+        "#include \"Value.h\"\n"
+        "#include \"Quickening.h\"\n"
+        "#include \"GlobalCache.h\"\n"
+        "\n"
+        "// The node when it has type T, nullptr otherwise (including for nullptr)\n"
+        "template<typename T, typename Node>\n"
+        "inline T* nodeCast(Node* node) {\n"
+        "    return node != nullptr && node->kind == T::KIND ? static_cast<T*>(node) : nullptr;\n"
+        "}\n",
+        {
+            {"Assign", {}, {"const Token name", "const Token op", "Expr* value"},
+                withGlobalCache("binding of a global target, filled on first assignment"), "", {}},
+            {"Binary", {}, {"Expr* left", "const Token oper", "Expr* right"},
+                {"QuickOp quick = QuickOp::Unspecialized;  // operand-type specialization, rewritten at run time"}, "", {}},
+            {"Call", {}, {"Expr* callee", "Token paren", "std::vector<Expr*> arguments"},
+                {"bool isTailCall = false;  // Flag for tail call optimization"}, "", {}},
+            {"Function", {}, {"std::vector<Token> params", "std::vector<Stmt*> body"},
+                {"FunctionPrototype prototype{\"anonymous\"};  // completed by the Resolver"}, "", {}},
+            {"Grouping", {}, {"Expr* expression"}, {}, "", {}},
+            {"Increment", {}, {"Expr* operand", "Token oper", "bool isPrefix  // true for ++x, false for x++"},
+                resolvedVariable, "", {}},
+            {"Literal", {}, {"const Value value  // decoded by the Parser (or produced by constant folding)"}, {}, "", {}},
+            {"Logical",
+                {"`and` / `or`: evaluates the right operand only when the left one does not",
+                 "decide the result, and yields whichever operand decided it"},
+                {"Expr* left", "const Token oper", "Expr* right"},
+                {"// Operands that are themselves logical, so a condition can branch through",
+                 "// them without building intermediate values. Kept in sync by link().",
+                 "LogicalExpr* leftLogical = nullptr;",
+                 "LogicalExpr* rightLogical = nullptr;"},
+                "link();",
+                {"",
+                 "void link() {",
+                 "    leftLogical = from(left);",
+                 "    rightLogical = from(right);",
+                 "}",
+                 "",
+                 "// The logical expression inside any parentheses, or nullptr",
+                 "static LogicalExpr* from(Expr* expression) {",
+                 "    while (auto* grouping = nodeCast<GroupingExpr>(expression)) {",
+                 "        expression = grouping->expression;",
+                 "    }",
+                 "    return nodeCast<LogicalExpr>(expression);",
+                 "}"}},
+            {"Unary", {}, {"Token oper", "Expr* right"},
+                {"QuickOp quick = QuickOp::Unspecialized;"}, "", {}},
+            {"Var", {}, {"Token name"},
+                withGlobalCache("binding of a global, filled on first evaluation"), "", {}},
+        }
+    });
 
+    defineAst(outputDir + "/Statement.h", {
+        "Stmt", "void", ", ExecutionContext* context = nullptr", ", context",
+        "#include <cstdint>\n"
+        "#include <utility>\n"
+        "#include <vector>\n"
+        "#include \"helperFunctions/ShortHands.h\"\n"
+        "#include \"TypeWrapper.h\"\n"
+        "#include \"Expression.h\"\n"
+        "\n"
+        "struct ExecutionContext {\n"
+        "    bool isFunctionBody = false;\n"
+        "    bool hasReturn = false;\n"
+        "    Value returnValue;\n"
+        "    // Pending tail call: the caller's trampoline reuses its frame to run it.\n"
+        "    // The callee and its arguments are on top of the interpreter's call stack.\n"
+        "    Function* tailCallee = nullptr;\n"
+        "    size_t tailArgumentCount = 0;\n"
+        "};\n",
+        {
+            {"Block", {}, {"std::vector<Stmt*> statements"},
+                {"// Set by the Resolver: whether the block runs in a scope of its own,",
+                 "// sized slotCount. Otherwise its variables, if any, take slots in the",
+                 "// enclosing frame or scope.",
+                 "bool hasScope = true;",
+                 "int slotCount = 0;"}, "", {}},
+            {"Expression", {}, {"Expr* expression"}, {}, "", {}},
+            {"Var", {}, {"Token name", "Expr* initializer"},
+                {"int slot = -1;  // set by the Resolver; -1 defines a global by name"}, "", {}},
+            {"Function", {}, {"const Token name", "const std::vector<Token> params", "std::vector<Stmt*> body"},
+                {"int slot = -1;  // set by the Resolver; -1 defines a global by name",
+                 "FunctionPrototype prototype{std::string(name.lexeme)};  // completed by the Resolver"}, "", {}},
+            {"Return", {}, {"const Token keyword", "Expr* value"}, {}, "", {}},
+            {"If", {}, {"Expr* condition", "Stmt* thenBranch", "Stmt* elseBranch"},
+                {"LogicalExpr* logicalCondition = nullptr;  // condition, when it is an and/or chain"},
+                "setCondition(condition);",
+                {"",
+                 "void setCondition(Expr* expression) {",
+                 "    condition = expression;",
+                 "    logicalCondition = LogicalExpr::from(expression);",
+                 "}"}},
+        }
+    });
+}